@@ -0,0 +1,105 @@
+/** *************************************************************************   
+ _____ _             _____ _____ _____ 
+|     |_|___ ___ ___|  _  |     |  _  |
+| | | | |  _|  _| . |     | | | |   __|
+|_|_|_|_|___|_| |___|__|__|_|_|_|__|                       
+
+MIT License
+
+Copyright (c) 2021 Mike Sharkey
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+****************************************************************************/
+#include "brisc_thread.h"
+#include "brisc_mutex.h"
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define BRISC_MUTEX_UNLOCKED    0
+#define BRISC_MUTEX_LOCKED      1
+#define BRISC_MUTEX_CONTENDED   2
+
+static void brisc_futex_wait(brisc_mutex_t* mutex,int32_t val);
+static void brisc_futex_wake(brisc_mutex_t* mutex);
+
+
+/** *************************************************************************  
+*************************** 'C' Public Interface ****************************
+****************************************************************************/
+
+void b_thread_yield(void)
+{
+    sched_yield();
+}
+
+brisc_systick_t b_thread_systick(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return (brisc_systick_t)((now.tv_sec*1000) + (now.tv_nsec/1000000));
+}
+
+void b_mutex_lock(brisc_mutex_t* mutex)
+{
+    int32_t state = BRISC_MUTEX_UNLOCKED;
+    if ( __atomic_compare_exchange_n(mutex,&state,BRISC_MUTEX_LOCKED,false,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED) )
+        return;
+    if ( state != BRISC_MUTEX_CONTENDED )
+        state = __atomic_exchange_n(mutex,BRISC_MUTEX_CONTENDED,__ATOMIC_ACQUIRE);
+    while ( state != BRISC_MUTEX_UNLOCKED )
+    {
+        brisc_futex_wait(mutex,BRISC_MUTEX_CONTENDED);
+        state = __atomic_exchange_n(mutex,BRISC_MUTEX_CONTENDED,__ATOMIC_ACQUIRE);
+    }
+}
+
+void b_mutex_unlock(brisc_mutex_t* mutex)
+{
+    if ( __atomic_exchange_n(mutex,BRISC_MUTEX_UNLOCKED,__ATOMIC_RELEASE) == BRISC_MUTEX_CONTENDED )
+        brisc_futex_wake(mutex);
+}
+
+bool b_mutex_try_lock(brisc_mutex_t* mutex)
+{
+    int32_t state = BRISC_MUTEX_UNLOCKED;
+    return !__atomic_compare_exchange_n(mutex,&state,BRISC_MUTEX_LOCKED,false,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED);
+}
+
+
+/** *************************************************************************  
+*************************** 'C' Static Interface ****************************
+****************************************************************************/
+
+/** *************************************************************************  
+ * \brief Sleep while @ref mutex holds @ref val. The futex is not 
+ *        FUTEX_PRIVATE_FLAG, so that it may be shared between processes.
+****************************************************************************/
+static void brisc_futex_wait(brisc_mutex_t* mutex,int32_t val)
+{
+    syscall(SYS_futex,mutex,FUTEX_WAIT,val,NULL,NULL,0);
+}
+
+static void brisc_futex_wake(brisc_mutex_t* mutex)
+{
+    syscall(SYS_futex,mutex,FUTEX_WAKE,1,NULL,NULL,0);
+}
@@ -0,0 +1,69 @@
+/** *************************************************************************   
+ _____ _             _____ _____ _____ 
+|     |_|___ ___ ___|  _  |     |  _  |
+| | | | |  _|  _| . |     | | | |   __|
+|_|_|_|_|___|_| |___|__|__|_|_|_|__|                       
+
+MIT License
+
+Copyright (c) 2021 Mike Sharkey
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+****************************************************************************/
+#ifndef __BRISC_MUTEX_H__
+#define __BRISC_MUTEX_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** *************************************************************************  
+ * \brief Host stand-in for the BRISC mutex, a process-shared futex word.
+ *        0 is unlocked, 1 locked, and 2 locked with sleepers. Being a plain
+ *        word it may be placed in memory mapped by several processes, and 
+ *        a zeroed mutex is unlocked, as microamp_init() expects.
+****************************************************************************/
+typedef int32_t brisc_mutex_t;
+
+/** *************************************************************************  
+ * \brief Blocking, lock the mutex.
+****************************************************************************/
+extern void b_mutex_lock(brisc_mutex_t* mutex);
+
+/** *************************************************************************  
+ * \brief Unlock the mutex, waking one sleeper.
+****************************************************************************/
+extern void b_mutex_unlock(brisc_mutex_t* mutex);
+
+/** *************************************************************************  
+ * \brief Non-blocking, lock the mutex.
+ * \return false when the lock was taken, true when it is held elsewhere.
+****************************************************************************/
+extern bool b_mutex_try_lock(brisc_mutex_t* mutex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
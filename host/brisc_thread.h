@@ -0,0 +1,63 @@
+/** *************************************************************************   
+ _____ _             _____ _____ _____ 
+|     |_|___ ___ ___|  _  |     |  _  |
+| | | | |  _|  _| . |     | | | |   __|
+|_|_|_|_|___|_| |___|__|__|_|_|_|__|                       
+
+MIT License
+
+Copyright (c) 2021 Mike Sharkey
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+****************************************************************************/
+#ifndef __BRISC_THREAD_H__
+#define __BRISC_THREAD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** *************************************************************************  
+ * \brief Host stand-in for the BRISC thread primitives used by MicroAMP, 
+ *        so that the ring code runs unmodified in Linux processes.
+****************************************************************************/
+typedef uintptr_t cpu_reg_t;
+typedef uint32_t  brisc_systick_t;
+
+/** *************************************************************************  
+ * \brief Give up the remainder of the time slice, sched_yield().
+****************************************************************************/
+extern void b_thread_yield(void);
+
+/** *************************************************************************  
+ * \return The CLOCK_MONOTONIC time in milliseconds.
+****************************************************************************/
+extern brisc_systick_t b_thread_systick(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
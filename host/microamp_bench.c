@@ -0,0 +1,501 @@
+/** *************************************************************************   
+ _____ _             _____ _____ _____ 
+|     |_|___ ___ ___|  _  |     |  _  |
+| | | | |  _|  _| . |     | | | |   __|
+|_|_|_|_|___|_| |___|__|__|_|_|_|__|                       
+
+MIT License
+
+Copyright (c) 2021 Mike Sharkey
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+****************************************************************************/
+#include <microamp_host.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define BENCH_RING_SIZE     (16*1024)
+#define BENCH_MAX_PAIRS     16
+#define BENCH_MAX_SAMPLES   (1<<20)
+#define BENCH_POLL          10      /**< systicks between stop checks */
+#define BENCH_SLOT_HDR      16      /**< allowance for a queue slot header when sizing nslots */
+
+/** *************************************************************************  
+ * \brief An endpoint mode under test, selected with -m.
+****************************************************************************/
+typedef struct _bench_type_
+{
+    const char*             name;
+    int                     flags;
+} bench_type_t;
+
+/** *************************************************************************  
+ * \brief One producer or consumer thread of a benchmark case.
+****************************************************************************/
+typedef struct _bench_thread_
+{
+    pthread_t               thread;
+    microamp_state_t*       state;
+    int                     nhandle;
+    int                     nreply;
+    size_t                  size;
+    volatile int*           stop;
+    uint64_t                msgs;
+    uint64_t*               samples;
+    size_t                  nsamples;
+} bench_thread_t;
+
+/** *************************************************************************  
+ * \brief The result of one benchmark case.
+****************************************************************************/
+typedef struct _bench_result_
+{
+    const char*             mode;
+    const char*             type;
+    size_t                  size;
+    int                     endpoints;
+    int                     pairs;
+    double                  seconds;
+    double                  mbps;
+    double                  msgps;
+    double                  p50;
+    double                  p99;
+    double                  p999;
+} bench_result_t;
+
+static const size_t bench_sizes[] = { 1, 8, 64, 256, 1024, 4096 };
+static const int bench_endpoints[] = { 1, 4 };
+static const bench_type_t bench_types[] = {
+    { "stream", MICROAMP_MODE_STREAM },
+    { "spsc",   MICROAMP_MODE_SPSC },
+    { "msg",    MICROAMP_MODE_MSG },
+    { "pow2",   MICROAMP_MODE_POW2 },
+    { "queue",  MICROAMP_MODE_MPMC },
+};
+
+static uint64_t bench_now_ns(void);
+static void* bench_producer(void* arg);
+static void* bench_consumer(void* arg);
+static void* bench_echo(void* arg);
+static int bench_cmp(const void* a,const void* b);
+static double bench_percentile(const uint64_t* sorted,size_t n,double pct);
+static int bench_selected(const char* modes,const char* name);
+static int bench_create(microamp_state_t* state,const char* name,const bench_type_t* type,size_t size);
+static void bench_case(microamp_state_t* state,const bench_type_t* type,size_t size,int endpoints,int pairs,int duration,bench_result_t* result);
+static void bench_pingpong(microamp_state_t* state,const bench_type_t* type,size_t size,int duration,bench_result_t* result);
+static void bench_json(FILE* fp,const bench_result_t* result);
+
+
+/** *************************************************************************  
+ * \brief Drive microamp_write_wait()/microamp_read_wait() across endpoint 
+ *        modes, message sizes, endpoint counts and producer/consumer pairs,
+ *        printing a table to stderr and one JSON object per case to stdout,
+ *        or to the -o file. -m takes a comma separated list of stream, 
+ *        spsc, msg, pow2 and queue, by default all of them; spsc runs one 
+ *        pair per endpoint only. The "load" cases report one-way latency 
+ *        under saturating load, from before the write to after the read, 
+ *        which is mostly queueing delay; it is measured for messages which
+ *        can carry a timestamp and reported as -1 (null) otherwise. The 
+ *        "pingpong" cases keep one message in flight, echoed back over a 
+ *        second endpoint, and report the unloaded round trip.
+ *        usage: microamp_bench [-d ms per case] [-p max pairs] [-m modes] [-o file]
+****************************************************************************/
+int main(int argc,char* argv[])
+{
+    int duration = 500;
+    int max_pairs = 4;
+    const char* modes = "all";
+    const char* out = NULL;
+    microamp_host_t host;
+    microamp_state_t* state;
+    FILE* fp = stdout;
+    int opt;
+
+    while ( (opt=getopt(argc,argv,"d:p:m:o:")) != -1 )
+    {
+        switch ( opt )
+        {
+            case 'd': duration = atoi(optarg); break;
+            case 'p': max_pairs = atoi(optarg); break;
+            case 'm': modes = optarg; break;
+            case 'o': out = optarg; break;
+            default:
+                fprintf(stderr,"usage: %s [-d ms] [-p pairs] [-m stream,spsc,msg,pow2,queue] [-o file]\n",argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ( max_pairs < 1 || max_pairs > BENCH_MAX_PAIRS )
+        max_pairs = BENCH_MAX_PAIRS;
+    if ( out != NULL && (fp=fopen(out,"w")) == NULL )
+    {
+        perror(out);
+        return EXIT_FAILURE;
+    }
+    if ( (state=microamp_host_create(&host,NULL,BENCH_MAX_PAIRS*BENCH_RING_SIZE)) == NULL )
+    {
+        perror("microamp_host_create");
+        return EXIT_FAILURE;
+    }
+
+    for(size_t t=0; t < sizeof(bench_types)/sizeof(bench_types[0]); t++)
+    {
+        const bench_type_t* type = &bench_types[t];
+        if ( !bench_selected(modes,type->name) )
+            continue;
+
+        fprintf(stderr,"%-6s %6s %4s %5s %10s %12s %10s %10s %10s\n","type","size","eps","pairs","MB/s","msgs/s","p50 ns","p99 ns","p999 ns");
+        for(size_t s=0; s < sizeof(bench_sizes)/sizeof(bench_sizes[0]); s++)
+        {
+            for(size_t e=0; e < sizeof(bench_endpoints)/sizeof(bench_endpoints[0]); e++)
+            {
+                for(int pairs=1; pairs <= max_pairs; pairs *= 2)
+                {
+                    bench_result_t result;
+                    if ( bench_endpoints[e] > pairs )
+                        continue;
+                    if ( (type->flags & MICROAMP_MODE_SPSC) && bench_endpoints[e] != pairs )
+                        continue;   /**< one reader and one writer per endpoint */
+                    bench_case(state,type,bench_sizes[s],bench_endpoints[e],pairs,duration,&result);
+                    fprintf(stderr,"%-6s %6zu %4d %5d %10.1f %12.0f %10.0f %10.0f %10.0f\n",
+                        result.type,result.size,result.endpoints,result.pairs,result.mbps,result.msgps,
+                        result.p50,result.p99,result.p999);
+                    bench_json(fp,&result);
+                }
+            }
+        }
+
+        fprintf(stderr,"\n%-6s %6s %12s %10s %10s %10s  (ping-pong round trip)\n","type","size","rtt/s","p50 ns","p99 ns","p999 ns");
+        for(size_t s=0; s < sizeof(bench_sizes)/sizeof(bench_sizes[0]); s++)
+        {
+            bench_result_t result;
+            bench_pingpong(state,type,bench_sizes[s],duration,&result);
+            fprintf(stderr,"%-6s %6zu %12.0f %10.0f %10.0f %10.0f\n",
+                result.type,result.size,result.msgps,result.p50,result.p99,result.p999);
+            bench_json(fp,&result);
+        }
+        fprintf(stderr,"\n");
+    }
+
+    if ( fp != stdout )
+        fclose(fp);
+    microamp_host_detach(&host);
+    return EXIT_SUCCESS;
+}
+
+
+/** *************************************************************************  
+ * \return Non-zero when @ref name is in the comma separated @ref modes, or 
+ *         @ref modes is "all".
+****************************************************************************/
+static int bench_selected(const char* modes,const char* name)
+{
+    size_t len = strlen(name);
+    if ( strcmp(modes,"all") == 0 )
+        return 1;
+    for(const char* p=modes; p != NULL; p = strchr(p,','), p = p ? p+1 : NULL)
+    {
+        if ( strncmp(p,name,len) == 0 && (p[len] == ',' || p[len] == '\0') )
+            return 1;
+    }
+    return 0;
+}
+
+/** *************************************************************************  
+ * \brief Create the endpoint @ref name in the mode of @ref type, a queue 
+ *        being sized to roughly BENCH_RING_SIZE of @ref size slots.
+****************************************************************************/
+static int bench_create(microamp_state_t* state,const char* name,const bench_type_t* type,size_t size)
+{
+    if ( type->flags & MICROAMP_MODE_MPMC )
+    {
+        size_t nslots = 2;
+        while ( nslots*2*(size+BENCH_SLOT_HDR) <= BENCH_RING_SIZE )
+            nslots *= 2;
+        return microamp_create_queue(state,name,size,nslots);
+    }
+    return microamp_create_ex(state,name,BENCH_RING_SIZE,type->flags);
+}
+
+/** *************************************************************************  
+ * \brief Run @ref pairs producer/consumer pairs spread over @ref endpoints
+ *        endpoints of @ref type for @ref duration milliseconds.
+****************************************************************************/
+static void bench_case(microamp_state_t* state,const bench_type_t* type,size_t size,int endpoints,int pairs,int duration,bench_result_t* result)
+{
+    bench_thread_t producer[BENCH_MAX_PAIRS];
+    bench_thread_t consumer[BENCH_MAX_PAIRS];
+    int handle[2][BENCH_MAX_PAIRS];
+    volatile int stop = 0;
+    uint64_t start, msgs = 0;
+    size_t nsamples = 0;
+    uint64_t* samples;
+    char name[16];
+
+    for(int n=0; n < endpoints; n++)
+    {
+        snprintf(name,sizeof(name),"bench%d",n);
+        bench_create(state,name,type,size);
+    }
+    memset(producer,0,sizeof(producer));
+    memset(consumer,0,sizeof(consumer));
+    for(int n=0; n < pairs; n++)
+    {
+        snprintf(name,sizeof(name),"bench%d",n%endpoints);
+        handle[0][n] = microamp_open(state,name);
+        handle[1][n] = microamp_open(state,name);
+        producer[n] = (bench_thread_t){ .state=state, .nhandle=handle[0][n], .size=size, .stop=&stop };
+        consumer[n] = (bench_thread_t){ .state=state, .nhandle=handle[1][n], .size=size, .stop=&stop };
+        if ( size >= sizeof(uint64_t) )
+            consumer[n].samples = malloc(BENCH_MAX_SAMPLES*sizeof(uint64_t));
+    }
+
+    start = bench_now_ns();
+    for(int n=0; n < pairs; n++)
+    {
+        pthread_create(&consumer[n].thread,NULL,bench_consumer,&consumer[n]);
+        pthread_create(&producer[n].thread,NULL,bench_producer,&producer[n]);
+    }
+    usleep(duration*1000);
+    stop = 1;
+    for(int n=0; n < pairs; n++)
+    {
+        pthread_join(producer[n].thread,NULL);
+        pthread_join(consumer[n].thread,NULL);
+        msgs += consumer[n].msgs;
+        nsamples += consumer[n].nsamples;
+    }
+
+    memset(result,0,sizeof(bench_result_t));
+    result->mode = "load";
+    result->type = type->name;
+    result->size = size;
+    result->endpoints = endpoints;
+    result->pairs = pairs;
+    result->seconds = (bench_now_ns()-start)/1e9;
+    result->msgps = msgs/result->seconds;
+    result->mbps = (msgs*size)/result->seconds/1e6;
+
+    samples = nsamples ? malloc(nsamples*sizeof(uint64_t)) : NULL;
+    nsamples = 0;
+    for(int n=0; n < pairs; n++)
+    {
+        if ( samples != NULL )
+            memcpy(&samples[nsamples],consumer[n].samples,consumer[n].nsamples*sizeof(uint64_t));
+        nsamples += consumer[n].nsamples;
+        free(consumer[n].samples);
+        microamp_close(state,handle[0][n]);
+        microamp_close(state,handle[1][n]);
+    }
+    if ( samples != NULL )
+    {
+        qsort(samples,nsamples,sizeof(uint64_t),bench_cmp);
+        result->p50 = bench_percentile(samples,nsamples,50.0);
+        result->p99 = bench_percentile(samples,nsamples,99.0);
+        result->p999 = bench_percentile(samples,nsamples,99.9);
+        free(samples);
+    }
+    else
+    {
+        result->p50 = result->p99 = result->p999 = -1;
+    }
+
+    for(int n=0; n < endpoints; n++)
+    {
+        snprintf(name,sizeof(name),"bench%d",n);
+        microamp_destroy(state,name);
+    }
+}
+
+/** *************************************************************************  
+ * \brief Bounce one message at a time through a "ping" endpoint and back 
+ *        through a "pong" endpoint for @ref duration milliseconds, so the 
+ *        rings are never loaded and each sample is a bare round trip.
+****************************************************************************/
+static void bench_pingpong(microamp_state_t* state,const bench_type_t* type,size_t size,int duration,bench_result_t* result)
+{
+    bench_thread_t echo;
+    int ping, pong;
+    volatile int stop = 0;
+    uint64_t start, deadline;
+    uint64_t* samples = malloc(BENCH_MAX_SAMPLES*sizeof(uint64_t));
+    size_t nsamples = 0;
+    uint64_t msgs = 0;
+    uint8_t buf[4096];
+
+    bench_create(state,"ping",type,size);
+    bench_create(state,"pong",type,size);
+    ping = microamp_open(state,"ping");
+    pong = microamp_open(state,"pong");
+    echo = (bench_thread_t){ .state=state, .nhandle=microamp_open(state,"ping"), .nreply=microamp_open(state,"pong"), .size=size, .stop=&stop };
+    pthread_create(&echo.thread,NULL,bench_echo,&echo);
+
+    memset(buf,0x55,sizeof(buf));
+    start = bench_now_ns();
+    deadline = start + (uint64_t)duration*1000000ull;
+    while ( bench_now_ns() < deadline )
+    {
+        uint64_t stamp = bench_now_ns();
+        if ( microamp_write_wait(state,ping,buf,size,BENCH_POLL) <= 0 )
+            continue;
+        while ( microamp_read_wait(state,pong,buf,size,BENCH_POLL) <= 0 )
+            ;
+        if ( samples != NULL && nsamples < BENCH_MAX_SAMPLES )
+            samples[nsamples++] = bench_now_ns()-stamp;
+        msgs++;
+    }
+    stop = 1;
+    pthread_join(echo.thread,NULL);
+
+    memset(result,0,sizeof(bench_result_t));
+    result->mode = "pingpong";
+    result->type = type->name;
+    result->size = size;
+    result->endpoints = 2;
+    result->pairs = 1;
+    result->seconds = (bench_now_ns()-start)/1e9;
+    result->msgps = msgs/result->seconds;
+    result->mbps = (msgs*size)/result->seconds/1e6;
+    if ( samples != NULL && nsamples )
+    {
+        qsort(samples,nsamples,sizeof(uint64_t),bench_cmp);
+        result->p50 = bench_percentile(samples,nsamples,50.0);
+        result->p99 = bench_percentile(samples,nsamples,99.0);
+        result->p999 = bench_percentile(samples,nsamples,99.9);
+    }
+    else
+    {
+        result->p50 = result->p99 = result->p999 = -1;
+    }
+    free(samples);
+
+    microamp_close(state,echo.nhandle);
+    microamp_close(state,echo.nreply);
+    microamp_close(state,ping);
+    microamp_close(state,pong);
+    microamp_destroy(state,"ping");
+    microamp_destroy(state,"pong");
+}
+
+/** *************************************************************************  
+ * \brief Write fixed size messages, stamped with the time before the write,
+ *        until stopped.
+****************************************************************************/
+static void* bench_producer(void* arg)
+{
+    bench_thread_t* bench = (bench_thread_t*)arg;
+    uint8_t buf[4096];
+    memset(buf,0x55,sizeof(buf));
+    while ( !*bench->stop )
+    {
+        uint64_t stamp = bench_now_ns();
+        if ( bench->size >= sizeof(stamp) )
+            memcpy(buf,&stamp,sizeof(stamp));
+        if ( microamp_write_wait(bench->state,bench->nhandle,buf,bench->size,BENCH_POLL) > 0 )
+            bench->msgs++;
+    }
+    return NULL;
+}
+
+/** *************************************************************************  
+ * \brief Read fixed size messages, and sample their latency, until stopped 
+ *        and drained.
+****************************************************************************/
+static void* bench_consumer(void* arg)
+{
+    bench_thread_t* bench = (bench_thread_t*)arg;
+    uint8_t buf[4096];
+    for(;;)
+    {
+        if ( microamp_read_wait(bench->state,bench->nhandle,buf,bench->size,BENCH_POLL) > 0 )
+        {
+            if ( bench->samples != NULL && bench->nsamples < BENCH_MAX_SAMPLES )
+            {
+                uint64_t stamp;
+                memcpy(&stamp,buf,sizeof(stamp));
+                bench->samples[bench->nsamples++] = bench_now_ns()-stamp;
+            }
+            bench->msgs++;
+        }
+        else if ( *bench->stop )
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/** *************************************************************************  
+ * \brief Return each message read from the ping endpoint on the pong 
+ *        endpoint, until stopped and drained.
+****************************************************************************/
+static void* bench_echo(void* arg)
+{
+    bench_thread_t* bench = (bench_thread_t*)arg;
+    uint8_t buf[4096];
+    for(;;)
+    {
+        if ( microamp_read_wait(bench->state,bench->nhandle,buf,bench->size,BENCH_POLL) > 0 )
+        {
+            while ( microamp_write_wait(bench->state,bench->nreply,buf,bench->size,BENCH_POLL) <= 0 && !*bench->stop )
+                ;
+            bench->msgs++;
+        }
+        else if ( *bench->stop )
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void bench_json(FILE* fp,const bench_result_t* result)
+{
+    fprintf(fp,"{\"mode\":\"%s\",\"type\":\"%s\",\"size\":%zu,\"endpoints\":%d,\"pairs\":%d,\"seconds\":%.3f,\"mb_per_s\":%.3f,\"msgs_per_s\":%.1f",
+        result->mode,result->type,result->size,result->endpoints,result->pairs,result->seconds,result->mbps,result->msgps);
+    if ( result->p50 >= 0 )
+        fprintf(fp,",\"p50_ns\":%.0f,\"p99_ns\":%.0f,\"p999_ns\":%.0f}\n",result->p50,result->p99,result->p999);
+    else
+        fprintf(fp,",\"p50_ns\":null,\"p99_ns\":null,\"p999_ns\":null}\n");
+    fflush(fp);
+}
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return ((uint64_t)now.tv_sec*1000000000ull) + now.tv_nsec;
+}
+
+static int bench_cmp(const void* a,const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static double bench_percentile(const uint64_t* sorted,size_t n,double pct)
+{
+    size_t index = (size_t)((pct/100.0)*(n-1));
+    return n ? (double)sorted[index] : 0;
+}
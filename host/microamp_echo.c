@@ -0,0 +1,95 @@
+/** *************************************************************************   
+ _____ _             _____ _____ _____ 
+|     |_|___ ___ ___|  _  |     |  _  |
+| | | | |  _|  _| . |     | | | |   __|
+|_|_|_|_|___|_| |___|__|__|_|_|_|__|                       
+
+MIT License
+
+Copyright (c) 2021 Mike Sharkey
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+****************************************************************************/
+#include <microamp_host.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+
+#define ECHO_SHARED_SIZE    (64*1024)
+#define ECHO_RING_SIZE      4096
+#define ECHO_TIMEOUT        100
+
+static volatile sig_atomic_t echo_done=0;
+
+static void echo_signal(int sig)
+{
+    (void)sig;
+    echo_done=1;
+}
+
+/** *************************************************************************  
+ * \brief A stand-in for the RT side. Creates the shared region @ref argv[1],
+ *        with endpoints "down" and "up", and writes back to "up" every 
+ *        record read from "down", until interrupted. Another process, such 
+ *        as the MicroPython unix port, attaches to the same name. Built 
+ *        with TRACE=1 it leaves its trace ring in microamp_echo.trace.
+****************************************************************************/
+int main(int argc,char* argv[])
+{
+    static uint8_t buf[ECHO_RING_SIZE];
+    const char* name = argc > 1 ? argv[1] : "/microamp";
+    microamp_host_t host;
+    microamp_state_t* state;
+    int down, up;
+
+    if ( (state=microamp_host_create(&host,name,ECHO_SHARED_SIZE)) == NULL )
+    {
+        perror(name);
+        return EXIT_FAILURE;
+    }
+    signal(SIGINT,echo_signal);
+    signal(SIGTERM,echo_signal);
+    microamp_create_ex(state,"down",ECHO_RING_SIZE,MICROAMP_MODE_MSG);
+    microamp_create_ex(state,"up",ECHO_RING_SIZE,MICROAMP_MODE_MSG);
+    down = microamp_open(state,"down");
+    up = microamp_open(state,"up");
+    printf("%s: echoing \"down\" to \"up\"\n",name);
+    fflush(stdout);
+
+    while ( !echo_done )
+    {
+        int len = microamp_read_wait(state,down,buf,sizeof(buf),ECHO_TIMEOUT);
+        if ( len > 0 )
+            microamp_write_wait(state,up,buf,len,MICROAMP_WAIT_FOREVER);
+    }
+
+    microamp_close(state,down);
+    microamp_close(state,up);
+    microamp_host_detach(&host);
+#if defined(MICROAMP_TRACE)
+    FILE* fp = fopen("microamp_echo.trace","wb");
+    if ( fp != NULL )
+    {
+        fwrite(&microamp_trace,sizeof(microamp_trace),1,fp);
+        fclose(fp);
+    }
+#endif
+    return EXIT_SUCCESS;
+}
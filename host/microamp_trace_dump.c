@@ -0,0 +1,176 @@
+/** *************************************************************************   
+ _____ _             _____ _____ _____ 
+|     |_|___ ___ ___|  _  |     |  _  |
+| | | | |  _|  _| . |     | | | |   __|
+|_|_|_|_|___|_| |___|__|__|_|_|_|__|                       
+
+MIT License
+
+Copyright (c) 2021 Mike Sharkey
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+****************************************************************************/
+#if !defined(MICROAMP_TRACE)
+#define MICROAMP_TRACE
+#endif
+#include <microamp_c.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+/** *************************************************************************  
+ * \brief A decoded record, with the core it came from.
+****************************************************************************/
+typedef struct _trace_entry_
+{
+    microamp_trace_rec_t    rec;
+    uint16_t                core;
+} trace_entry_t;
+
+static const char* trace_name(int event);
+static int trace_load(const char* path,trace_entry_t** entries,size_t* nentries);
+static int trace_cmp(const void* a,const void* b);
+
+
+/** *************************************************************************  
+ * \brief Decode one or more binary images of microamp_trace, one per core,
+ *        merging them into a single timeline ordered by time stamp, so 
+ *        that the interleaving of writes, reads, poll hook dispatch and 
+ *        callbacks across cores can be read off. The cores must share a 
+ *        time base for the merge to be meaningful.
+ *        usage: microamp_trace_dump core0.trace [core1.trace ...]
+****************************************************************************/
+int main(int argc,char* argv[])
+{
+    trace_entry_t* entries = NULL;
+    size_t nentries = 0;
+    uint32_t first;
+
+    if ( argc < 2 )
+    {
+        fprintf(stderr,"usage: %s core0.trace [core1.trace ...]\n",argv[0]);
+        return EXIT_FAILURE;
+    }
+    for(int n=1; n < argc; n++)
+    {
+        if ( trace_load(argv[n],&entries,&nentries) < 0 )
+            return EXIT_FAILURE;
+    }
+    if ( nentries == 0 )
+        return EXIT_SUCCESS;
+
+    qsort(entries,nentries,sizeof(trace_entry_t),trace_cmp);
+    first = entries[0].rec.time;
+    printf("%10s %10s %4s %8s %-10s %8s %10s\n","time","delta","core","seq","event","endpoint","bytes");
+    for(size_t n=0; n < nentries; n++)
+    {
+        const microamp_trace_rec_t* rec = &entries[n].rec;
+        printf("%10u %10u %4u %8u %-10s %8u %10u\n",
+            rec->time,rec->time-first,entries[n].core,rec->seq,
+            trace_name(rec->event),rec->endpoint,rec->bytes);
+    }
+    free(entries);
+    return EXIT_SUCCESS;
+}
+
+
+/** *************************************************************************  
+ * \brief Append the complete records of the trace image at @ref path. 
+ *        Records overwritten by newer events, or caught half written, 
+ *        are dropped and reported.
+ * \return 0, or < 0 on error.
+****************************************************************************/
+static int trace_load(const char* path,trace_entry_t** entries,size_t* nentries)
+{
+    microamp_trace_t hdr;
+    microamp_trace_rec_t* rec;
+    size_t nrec, dropped = 0;
+    FILE* fp = fopen(path,"rb");
+
+    if ( fp == NULL )
+    {
+        perror(path);
+        return -1;
+    }
+    if ( fread(&hdr,offsetof(microamp_trace_t,rec),1,fp) != 1 || 
+         hdr.magic != MICROAMP_TRACE_MAGIC || hdr.size == 0 || (hdr.size & (hdr.size-1)) )
+    {
+        fprintf(stderr,"%s: not a MicroAMP trace\n",path);
+        fclose(fp);
+        return -1;
+    }
+    rec = calloc(hdr.size,sizeof(microamp_trace_rec_t));
+    nrec = fread(rec,sizeof(microamp_trace_rec_t),hdr.size,fp);
+    fclose(fp);
+
+    *entries = realloc(*entries,(*nentries+nrec)*sizeof(trace_entry_t));
+    for(size_t n=0; n < nrec; n++)
+    {
+        /* valid are the last 'size' events claimed before the image was taken */
+        if ( rec[n].seq == 0 || hdr.head-rec[n].seq >= hdr.size || (rec[n].seq-1) % hdr.size != n )
+        {
+            if ( n < hdr.head )
+                dropped++;
+            continue;
+        }
+        (*entries)[*nentries].rec = rec[n];
+        (*entries)[*nentries].core = hdr.core;
+        ++*nentries;
+    }
+    if ( hdr.head > hdr.size )
+        fprintf(stderr,"%s: core %u, %u events, the oldest %u overwritten\n",path,hdr.core,hdr.head,hdr.head-hdr.size);
+    if ( dropped )
+        fprintf(stderr,"%s: core %u, %zu records incomplete\n",path,hdr.core,dropped);
+    free(rec);
+    return 0;
+}
+
+static int trace_cmp(const void* a,const void* b)
+{
+    const trace_entry_t* x = (const trace_entry_t*)a;
+    const trace_entry_t* y = (const trace_entry_t*)b;
+    int32_t dt = (int32_t)(x->rec.time-y->rec.time);
+    if ( dt )
+        return dt < 0 ? -1 : 1;
+    if ( x->core != y->core )
+        return x->core < y->core ? -1 : 1;
+    return x->rec.seq < y->rec.seq ? -1 : x->rec.seq > y->rec.seq;
+}
+
+static const char* trace_name(int event)
+{
+    switch ( event )
+    {
+        case MICROAMP_TRACE_WRITE:      return "write";
+        case MICROAMP_TRACE_READ:       return "read";
+        case MICROAMP_TRACE_OVRFL:      return "overflow";
+        case MICROAMP_TRACE_UNDFL:      return "underflow";
+        case MICROAMP_TRACE_LOCK:       return "lock";
+        case MICROAMP_TRACE_UNLOCK:     return "unlock";
+        case MICROAMP_TRACE_POLL:       return "poll";
+        case MICROAMP_TRACE_CB_ENTER:   return "cb_enter";
+        case MICROAMP_TRACE_CB_EXIT:    return "cb_exit";
+        case MICROAMP_TRACE_PY_POLL:    return "py_poll";
+        case MICROAMP_TRACE_PY_ENTER:   return "py_enter";
+        case MICROAMP_TRACE_PY_EXIT:    return "py_exit";
+    }
+    return "?";
+}
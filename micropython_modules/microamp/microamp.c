@@ -28,8 +28,14 @@ SOFTWARE.
 
 ****************************************************************************/
 #include "microamp.h"
+#include <py/binary.h>
+#include <py/mperrno.h>
+#include <py/stream.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(MICROAMP_HOST)
+#include <microamp_host.h>
+#endif
 
 /** *************************************************************************  
  * \note \ref g_microamp_state is Kind of a dirty hack for now to provide a 
@@ -43,29 +49,35 @@ extern microamp_state_t* g_microamp_state;
 ****************************************************************************/
 void py_microamp_poll_hook(void)
 {
-
-    for(int nenadpoint=0; nenadpoint < g_microamp_state->endpointcnt; nenadpoint++)
+    for(int word=0; word < MICROAMP_PENDING_WORDS; word++)
     {
-        volatile microamp_endpoint_t* endpoint = &g_microamp_state->endpoint[nenadpoint];
-        
-        /** Handle the Python-side events */
-        if ( endpoint->dataready_event.py_fn || endpoint->dataempty_event.py_fn )
+        uint32_t pending = microamp_pending_take(g_microamp_state,MICROAMP_HOOK_PY,word);
+        while ( pending )
         {
-            size_t avail;
+            int nendpoint = (word*32) + __builtin_ctz(pending);
+            volatile microamp_endpoint_t* endpoint = &g_microamp_state->endpoint[nendpoint];
+            int events;
+            pending &= pending-1;
+            if ( endpoint->ctrl == NULL )
+                continue;
+            events = microamp_poll_events(g_microamp_state,MICROAMP_HOOK_PY,nendpoint);
+            microamp_trace_event(MICROAMP_TRACE_PY_POLL,nendpoint,events);
             
-            b_mutex_lock((brisc_mutex_t*)&endpoint->mutex);
-            avail = microamp_ring_avail(endpoint->head,endpoint->tail,endpoint->shmemsz);
-            endpoint->dataempty = !avail;
-            b_mutex_unlock((brisc_mutex_t*)&endpoint->mutex);
-
-            if ( avail && endpoint->dataready_event.py_fn )
+            /** Handle the Python-side events */
+            if ( (events & MICROAMP_EVENT_READY) && endpoint->dataready_event.py_fn )
             {
+                __atomic_fetch_add(&endpoint->ctrl->callbacks,1,__ATOMIC_RELAXED);
+                microamp_trace_event(MICROAMP_TRACE_PY_ENTER,nendpoint,MICROAMP_EVENT_READY);
                 mp_call_function_1(endpoint->dataready_event.py_fn,endpoint->dataready_event.py_arg);
+                microamp_trace_event(MICROAMP_TRACE_PY_EXIT,nendpoint,MICROAMP_EVENT_READY);
             }
 
-            if ( !avail && endpoint->dataempty && endpoint->dataempty_event.py_fn )
+            if ( (events & MICROAMP_EVENT_EMPTY) && endpoint->dataempty_event.py_fn )
             {
+                __atomic_fetch_add(&endpoint->ctrl->callbacks,1,__ATOMIC_RELAXED);
+                microamp_trace_event(MICROAMP_TRACE_PY_ENTER,nendpoint,MICROAMP_EVENT_EMPTY);
                 mp_call_function_1(endpoint->dataempty_event.py_fn,endpoint->dataempty_event.py_arg);
+                microamp_trace_event(MICROAMP_TRACE_PY_EXIT,nendpoint,MICROAMP_EVENT_EMPTY);
             }
         }
     }
@@ -82,20 +94,42 @@ void py_microamp_poll_hook(void)
  *        of @ref size bytes.
  * \param name The ascii name of the endpoint.
  * \param size The size of the shared memory buffer to allocate
+ * \param flags (optional) MODE_xxx bits.
  * \return 0 upon success, or < 0 indicates an error condition.
 ****************************************************************************/
-STATIC mp_obj_t microamp_py_create(mp_obj_t name_obj, mp_obj_t size_obj) 
+STATIC mp_obj_t microamp_py_create(size_t n_args, const mp_obj_t* args) 
 {
-    if ( mp_obj_is_str(name_obj) && mp_obj_is_int(size_obj) )
+    if ( mp_obj_is_str(args[0]) && mp_obj_is_int(args[1]) )
     {
-        const char* name = mp_obj_str_get_str(name_obj);
-        size_t size = mp_obj_get_int(size_obj);
+        const char* name = mp_obj_str_get_str(args[0]);
+        size_t size = mp_obj_get_int(args[1]);
+        int flags = n_args > 2 ? mp_obj_get_int(args[2]) : MICROAMP_MODE_STREAM;
 
-        return mp_obj_new_int( microamp_create( g_microamp_state,name,size) );
+        return mp_obj_new_int( microamp_create_ex( g_microamp_state,name,size,flags) );
+    }
+    return mp_obj_new_int(MICROAMP_ERR_INVAL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(microamp_py_create_obj, 2, 3, microamp_py_create);
+
+
+/** *************************************************************************   
+ * \brief Create a new multi-producer/multi-consumer queue endpoint using 
+ *        @name, of @ref nslots messages of up to @ref slotsz bytes.
+ * \param name The ascii name of the endpoint.
+ * \param slotsz The largest message in bytes.
+ * \param nslots The number of slots, a power of 2.
+ * \return 0 or  < 0 indicates and error condition.
+****************************************************************************/
+STATIC mp_obj_t microamp_py_create_queue(mp_obj_t name_obj, mp_obj_t slotsz_obj, mp_obj_t nslots_obj) 
+{
+    if ( mp_obj_is_str(name_obj) && mp_obj_is_int(slotsz_obj) && mp_obj_is_int(nslots_obj) )
+    {
+        const char* name = mp_obj_str_get_str(name_obj);
+        return mp_obj_new_int( microamp_create_queue( g_microamp_state,name,mp_obj_get_int(slotsz_obj),mp_obj_get_int(nslots_obj)) );
     }
     return mp_obj_new_int(MICROAMP_ERR_INVAL);
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_2(microamp_py_create_obj, microamp_py_create);
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(microamp_py_create_queue_obj, microamp_py_create_queue);
 
 
 /** *************************************************************************   
@@ -125,6 +159,30 @@ STATIC mp_obj_t microamp_py_count()
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(microamp_py_count_obj, microamp_py_count);
 
 
+#if defined(MICROAMP_HOST)
+/** *************************************************************************   
+ * \brief On the unix port, map the shared region created by the C side 
+ *        under @name, in place of the target's shared RAM.
+ * \param name The shm_open() name of the region, such as "/microamp".
+ * \return 0 or  < 0 indicates and error condition.
+****************************************************************************/
+STATIC mp_obj_t microamp_py_host_attach(mp_obj_t name_obj) 
+{
+    static microamp_host_t host;
+    if ( mp_obj_is_str(name_obj) )
+    {
+        if ( host.addr != NULL )
+            microamp_host_detach(&host);
+        if ( microamp_host_attach(&host,mp_obj_str_get_str(name_obj)) == NULL )
+            return mp_obj_new_int(MICROAMP_ERR_NONE);
+        return mp_obj_new_int(0);
+    }
+    return mp_obj_new_int(MICROAMP_ERR_INVAL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microamp_py_host_attach_obj, microamp_py_host_attach);
+#endif
+
+
 /** *************************************************************************   
  * \param index the index of the endpoint to query.
  * \return the endpoint at \ref index.
@@ -156,6 +214,24 @@ STATIC mp_obj_t microamp_py_open(mp_obj_t name_obj)
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microamp_py_open_obj, microamp_py_open);
 
 
+/** *************************************************************************   
+ * \brief Destroy an endpoint by @name, its slot and shared memory are 
+ *        reclaimed once the last handle is closed.
+ * \param name The ascii name of the endpoint.
+ * \return 0 or  < 0 indicates and error condition.
+****************************************************************************/
+STATIC mp_obj_t microamp_py_destroy(mp_obj_t name_obj) 
+{
+    if ( mp_obj_is_str(name_obj) )
+    {
+        const char* name = mp_obj_str_get_str(name_obj);
+        return mp_obj_new_int( microamp_destroy( g_microamp_state,name) );
+    }
+    return mp_obj_new_int(MICROAMP_ERR_INVAL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microamp_py_destroy_obj, microamp_py_destroy);
+
+
 /** *************************************************************************   
  * \brief Close an endpoint by @handle
  * \param handle The ascii name of the endpoint.
@@ -173,6 +249,23 @@ STATIC mp_obj_t microamp_py_close(mp_obj_t handle_obj)
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microamp_py_close_obj, microamp_py_close);
 
 
+/** *************************************************************************   
+ * \brief Start a read cursor for @handle on a MODE_BCAST endpoint.
+ * \param handle The handle of the endpoint.
+ * \return 0 or  < 0 indicates and error condition.
+****************************************************************************/
+STATIC mp_obj_t microamp_py_subscribe(mp_obj_t handle_obj) 
+{
+    if ( mp_obj_is_int(handle_obj) )
+    {
+        int handle = mp_obj_get_int(handle_obj);
+        return mp_obj_new_int( microamp_subscribe(g_microamp_state,handle) );
+    }
+    return mp_obj_new_int(MICROAMP_ERR_INVAL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microamp_py_subscribe_obj, microamp_py_subscribe);
+
+
 /** *************************************************************************   
  * \brief Blocking, lock the buffer semaphore.
  * \param nhandle The handle of the endpoint.
@@ -246,6 +339,39 @@ STATIC mp_obj_t microamp_py_read(mp_obj_t handle_obj,mp_obj_t buffer_obj,mp_obj_
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(microamp_py_read_obj, microamp_py_read);
 
 
+/** *************************************************************************   
+ * \brief Read bytes from the endpoint associated with \ref nhandle into a
+ *        caller owned writable buffer (bytearray, memoryview, array).
+ * \param nhandle The handle of the endpoint.
+ * \param buffer The writable buffer object to read into.
+ * \param nbytes (optional) The maximum number of bytes to read, defaults 
+ *        to the length of \ref buffer.
+ * \return the number of bytes read, or < 0 on error.
+****************************************************************************/
+STATIC mp_obj_t microamp_py_readinto(size_t n_args, const mp_obj_t* args) 
+{
+    if ( mp_obj_is_int(args[0]) )
+    {
+        mp_buffer_info_t bufinfo;
+        int nhandle = mp_obj_get_int(args[0]);
+        mp_get_buffer_raise(args[1],&bufinfo,MP_BUFFER_WRITE);
+        size_t size = bufinfo.len;
+        if ( n_args > 2 && (size_t)mp_obj_get_int(args[2]) < size )
+            size = mp_obj_get_int(args[2]);
+        int avail = microamp_avail(g_microamp_state,nhandle);
+        if ( avail < 0 )
+            return mp_obj_new_int(avail);
+        if ( (size_t)avail < size )
+            size = avail;
+        if ( size == 0 )
+            return mp_obj_new_int(0);
+        return mp_obj_new_int( microamp_read(g_microamp_state,nhandle,bufinfo.buf,size) );
+    }
+    return mp_obj_new_int(MICROAMP_ERR_INVAL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(microamp_py_readinto_obj, 2, 3, microamp_py_readinto);
+
+
 /** *************************************************************************   
  * \brief Write bytes to the endpoint associated with \ref nhandle.
  * \param nhandle The handle of the endpoint.
@@ -269,27 +395,29 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_3(microamp_py_write_obj, microamp_py_write);
 
 
 /** *************************************************************************   
- * \brief Read bytes from the endpoint associated with \ref nhandle.
+ * \brief Read all available bytes from the endpoint associated with 
+ *        \ref nhandle, directly into the storage of the result.
+ *        On a MODE_MSG endpoint this is exactly one message (channel_recv).
  * \param nhandle The handle of the endpoint
- * \return the number of bytes read, or < 0 on error.
+ * \return the bytes read, empty on error.
 ****************************************************************************/
 STATIC mp_obj_t microamp_py_get(mp_obj_t handle_obj) 
 {
     if ( mp_obj_is_int(handle_obj) )
     {
         int nhandle = mp_obj_get_int(handle_obj);
-        size_t bytes_len = microamp_avail(g_microamp_state,nhandle);
-        byte* bytes_ptr = m_new(byte, bytes_len + 1);
-        if ( bytes_ptr )
+        int bytes_len = microamp_avail(g_microamp_state,nhandle);
+        if ( bytes_len > 0 )
         {
-            int bytes_got = microamp_read(g_microamp_state,nhandle,bytes_ptr,bytes_len);
+            vstr_t vstr;
+            vstr_init_len(&vstr,bytes_len);
+            int bytes_got = microamp_read(g_microamp_state,nhandle,vstr.buf,bytes_len);
             if ( bytes_got >= 0 )
             {
-                mp_obj_t result = mp_obj_new_bytes(bytes_ptr,bytes_got);
-                m_free(bytes_ptr);
-                return result;
+                vstr.len = bytes_got;
+                return mp_obj_new_str_from_vstr(&mp_type_bytes,&vstr);
             }
-            m_free(bytes_ptr);
+            vstr_clear(&vstr);
         }
     }
     return mp_obj_new_bytes((const byte*)"",0);
@@ -299,6 +427,8 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(microamp_py_get_obj, microamp_py_get);
 
 /** *************************************************************************   
  * \brief Write bytes to the endpoint associated with \ref nhandle.
+ *        On a MODE_MSG endpoint this enqueues one whole message or 
+ *        nothing (channel_send).
  * \param nhandle The handle of the endpoint.
  * \param buffer A pointer to the write storage buffer area.
  * \return the number of bytes written, or < 0 on error.
@@ -307,23 +437,62 @@ STATIC mp_obj_t microamp_py_put(mp_obj_t handle_obj,mp_obj_t buffer_obj)
 {
     if ( mp_obj_is_int(handle_obj) )
     {
+        mp_buffer_info_t bufinfo;
         int nhandle = mp_obj_get_int(handle_obj);
-        if ( nhandle >= 0 && nhandle < MICROAMP_MAX_HANDLE)
-        {
-            if ( /* mp_obj_is_str_or_bytes(buffer_obj) */ 1 )
-            {
-                size_t bytes_got;
-                const uint8_t* bytes_ptr = (const uint8_t*)mp_obj_str_get_data(buffer_obj,&bytes_got);
-                if ( microamp_write(g_microamp_state,nhandle,bytes_ptr,bytes_got) >= 0 )
-                    return  mp_obj_new_bytes(bytes_ptr,bytes_got);
-            }
-        }
+        mp_get_buffer_raise(buffer_obj,&bufinfo,MP_BUFFER_READ);
+        return mp_obj_new_int( microamp_write(g_microamp_state,nhandle,bufinfo.buf,bufinfo.len) );
     }
-    return mp_obj_new_bytes((const byte*)"",0);
+    return mp_obj_new_int(MICROAMP_ERR_INVAL);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(microamp_py_put_obj, microamp_py_put);
 
 
+/** *************************************************************************   
+ * \brief Inspect the bytes pending on the endpoint without consuming them.
+ * \param nhandle The handle of the endpoint
+ * \return a tuple of two memoryviews over the shared ring, before and
+ *         after the wrap, or < 0 on error. The views are only valid until 
+ *         channel_skip().
+****************************************************************************/
+STATIC mp_obj_t microamp_py_peek(mp_obj_t handle_obj) 
+{
+    if ( mp_obj_is_int(handle_obj) )
+    {
+        microamp_iovec_t seg[2] = {{NULL,0},{NULL,0}};
+        int nhandle = mp_obj_get_int(handle_obj);
+        int rc = microamp_peek(g_microamp_state,nhandle,seg);
+        if ( rc < 0 )
+            return mp_obj_new_int(rc);
+        mp_obj_t items[2] = {
+            mp_obj_new_memoryview(BYTEARRAY_TYPECODE,seg[0].len,seg[0].base),
+            mp_obj_new_memoryview(BYTEARRAY_TYPECODE,seg[1].len,seg[1].base),
+        };
+        return mp_obj_new_tuple(2,items);
+    }
+    return mp_obj_new_int(MICROAMP_ERR_INVAL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microamp_py_peek_obj, microamp_py_peek);
+
+
+/** *************************************************************************   
+ * \brief Consume bytes previously inspected with channel_peek.
+ * \param nhandle The handle of the endpoint.
+ * \param size The number of bytes to consume.
+ * \return the number of bytes skipped, or < 0 on error.
+****************************************************************************/
+STATIC mp_obj_t microamp_py_skip(mp_obj_t handle_obj,mp_obj_t size_obj) 
+{
+    if ( mp_obj_is_int(handle_obj) && mp_obj_is_int(size_obj) )
+    {
+        int nhandle = mp_obj_get_int(handle_obj);
+        size_t size = mp_obj_get_int(size_obj);
+        return mp_obj_new_int( microamp_skip(g_microamp_state,nhandle,size) );
+    }
+    return mp_obj_new_int(MICROAMP_ERR_INVAL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(microamp_py_skip_obj, microamp_py_skip);
+
+
 /** *************************************************************************   
  * \brief Number of bytes available bytes to the endpoint associated 
  *        with \ref nhandle.
@@ -342,45 +511,291 @@ STATIC mp_obj_t microamp_py_avail(mp_obj_t handle_obj)
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microamp_py_avail_obj, microamp_py_avail);
 
 /** *************************************************************************   
- * \brief Add a dataready event callback
+ * \brief The counters of the endpoint associated with \ref nhandle.
+ * \param nhandle The handle of the endpoint.
+ * \return a dict of the counters, or < 0 on error.
+****************************************************************************/
+STATIC mp_obj_t microamp_py_stats(mp_obj_t handle_obj) 
+{
+    microamp_stats_t stats;
+    if ( mp_obj_is_int(handle_obj) )
+    {
+        int rc = microamp_stats(g_microamp_state,mp_obj_get_int(handle_obj),&stats);
+        if ( rc < 0 )
+            return mp_obj_new_int(rc);
+
+        mp_obj_t dict = mp_obj_new_dict(11);
+        mp_obj_dict_store(dict,MP_OBJ_NEW_QSTR(MP_QSTR_bytes_in),mp_obj_new_int_from_ull(stats.bytes_in));
+        mp_obj_dict_store(dict,MP_OBJ_NEW_QSTR(MP_QSTR_bytes_out),mp_obj_new_int_from_ull(stats.bytes_out));
+        mp_obj_dict_store(dict,MP_OBJ_NEW_QSTR(MP_QSTR_msgs_in),mp_obj_new_int_from_uint(stats.msgs_in));
+        mp_obj_dict_store(dict,MP_OBJ_NEW_QSTR(MP_QSTR_msgs_out),mp_obj_new_int_from_uint(stats.msgs_out));
+        mp_obj_dict_store(dict,MP_OBJ_NEW_QSTR(MP_QSTR_overflows),mp_obj_new_int_from_uint(stats.overflows));
+        mp_obj_dict_store(dict,MP_OBJ_NEW_QSTR(MP_QSTR_underflows),mp_obj_new_int_from_uint(stats.underflows));
+        mp_obj_dict_store(dict,MP_OBJ_NEW_QSTR(MP_QSTR_drops),mp_obj_new_int_from_uint(stats.drops));
+        mp_obj_dict_store(dict,MP_OBJ_NEW_QSTR(MP_QSTR_peak),mp_obj_new_int_from_uint(stats.peak));
+        mp_obj_dict_store(dict,MP_OBJ_NEW_QSTR(MP_QSTR_callbacks),mp_obj_new_int_from_uint(stats.callbacks));
+        mp_obj_dict_store(dict,MP_OBJ_NEW_QSTR(MP_QSTR_lock_contended),mp_obj_new_int_from_uint(stats.lock_contended));
+        mp_obj_dict_store(dict,MP_OBJ_NEW_QSTR(MP_QSTR_lock_wait),mp_obj_new_int_from_uint(stats.lock_wait));
+        return dict;
+    }
+    return mp_obj_new_int(MICROAMP_ERR_INVAL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microamp_py_stats_obj, microamp_py_stats);
+
+/** *************************************************************************   
+ * \brief Add a dataready event callback, edge triggered when the bytes 
+ *        available rise to the watermark.
  * \param callback A function pointer.
  * \param arg The arg to pass to the callback.
- * \return the number of bytes available, or < 0 on error.
+ * \param rx_watermark (optional) The threshold in bytes, default 1. It 
+ *        applies to the Python registration only.
+ * \return the callback, or < 0 on error.
 ****************************************************************************/
-STATIC mp_obj_t microamp_py_dataready_handler(mp_obj_t handle_obj,mp_obj_t callback_obj,mp_obj_t arg_obj) 
+STATIC mp_obj_t microamp_py_dataready_handler(size_t n_args, const mp_obj_t* args) 
 {
-    if ( mp_obj_is_int(handle_obj) && mp_obj_is_callable(callback_obj) )
+    if ( mp_obj_is_int(args[0]) && mp_obj_is_callable(args[1]) )
     {
-        int nhandle = mp_obj_get_int(handle_obj);
-        microamp_handle_t* handle = &g_microamp_state->handle[nhandle];
-        handle->endpoint->dataready_event.py_fn = callback_obj;
-        handle->endpoint->dataready_event.py_arg = arg_obj;
-        return callback_obj;
+        int nhandle = mp_obj_get_int(args[0]);
+        mp_int_t rx_watermark = n_args > 3 ? mp_obj_get_int(args[3]) : 1;
+        microamp_endpoint_t* endpoint;
+        if ( rx_watermark < 0 )
+            return mp_obj_new_int(MICROAMP_ERR_INVAL);
+        endpoint = microamp_handle_endpoint(g_microamp_state,nhandle);
+        if ( endpoint == NULL )
+            return mp_obj_new_int(MICROAMP_ERR_NONE);
+        endpoint->dataready_event.py_fn = args[1];
+        endpoint->dataready_event.py_arg = args[2];
+        endpoint->dataready_event.py_watermark = rx_watermark;
+        microamp_pending_set(g_microamp_state,MICROAMP_HOOK_PY,endpoint - g_microamp_state->endpoint);
+        return args[1];
     }
     return mp_obj_new_int(MICROAMP_ERR_INVAL);
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_3(microamp_py_dataready_handler_obj, microamp_py_dataready_handler);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(microamp_py_dataready_handler_obj, 3, 4, microamp_py_dataready_handler);
 
 
 /** *************************************************************************   
- * \brief Add a dataempty event callback
+ * \brief Add a dataempty event callback, edge triggered when the bytes 
+ *        available fall to the watermark.
  * \param callback A function pointer.
  * \param arg The arg to pass to the callback.
- * \return the number of bytes available, or < 0 on error.
+ * \param tx_low_watermark (optional) The threshold in bytes, default 0. 
+ *        It applies to the Python registration only.
+ * \return the callback, or < 0 on error.
 ****************************************************************************/
-STATIC mp_obj_t microamp_py_dataempty_handler(mp_obj_t handle_obj,mp_obj_t callback_obj,mp_obj_t arg_obj) 
+STATIC mp_obj_t microamp_py_dataempty_handler(size_t n_args, const mp_obj_t* args) 
 {
-    if ( mp_obj_is_int(handle_obj) && mp_obj_is_callable(callback_obj) )
+    if ( mp_obj_is_int(args[0]) && mp_obj_is_callable(args[1]) )
     {
-        int nhandle = mp_obj_get_int(handle_obj);
-        microamp_handle_t* handle = &g_microamp_state->handle[nhandle];
-        handle->endpoint->dataempty_event.py_fn = callback_obj;
-        handle->endpoint->dataempty_event.py_arg = arg_obj;
-        return callback_obj;
+        int nhandle = mp_obj_get_int(args[0]);
+        mp_int_t tx_low_watermark = n_args > 3 ? mp_obj_get_int(args[3]) : 0;
+        microamp_endpoint_t* endpoint;
+        if ( tx_low_watermark < 0 )
+            return mp_obj_new_int(MICROAMP_ERR_INVAL);
+        endpoint = microamp_handle_endpoint(g_microamp_state,nhandle);
+        if ( endpoint == NULL )
+            return mp_obj_new_int(MICROAMP_ERR_NONE);
+        endpoint->dataempty_event.py_fn = args[1];
+        endpoint->dataempty_event.py_arg = args[2];
+        endpoint->dataempty_event.py_watermark = tx_low_watermark;
+        microamp_pending_set(g_microamp_state,MICROAMP_HOOK_PY,endpoint - g_microamp_state->endpoint);
+        return args[1];
     }
     return mp_obj_new_int(MICROAMP_ERR_INVAL);
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_3(microamp_py_dataempty_handler_obj, microamp_py_dataempty_handler);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(microamp_py_dataempty_handler_obj, 3, 4, microamp_py_dataempty_handler);
+
+
+/** *************************************************************************  
+*************************** Python Channel Stream ***************************
+****************************************************************************/
+
+/** *************************************************************************  
+ * \brief A channel opened as a stream object, usable with select.poll and
+ *        uasyncio.StreamReader/StreamWriter.
+****************************************************************************/
+typedef struct _microamp_py_channel_obj_t
+{
+    mp_obj_base_t               base;
+    int                         nhandle;
+    size_t                      wrneed;     /**< message size a write is waiting to fit */
+} microamp_py_channel_obj_t;
+
+const mp_obj_type_t microamp_py_channel_type;
+
+/** *************************************************************************   
+ * \return The largest message a MODE_MSG or queue endpoint can ever hold.
+****************************************************************************/
+STATIC size_t microamp_py_channel_maxmsg(const microamp_endpoint_t* endpoint)
+{
+    size_t capacity;
+    if ( endpoint->flags & MICROAMP_MODE_MPMC )
+        return endpoint->slotsz;
+    capacity = endpoint->shmemsz - ((endpoint->flags & MICROAMP_MODE_POW2) ? 0 : 1);
+    return capacity > sizeof(uint32_t) ? capacity - sizeof(uint32_t) : 0;
+}
+
+/** *************************************************************************   
+ * \brief Channel(name) opens the endpoint @name as a stream. The handle is
+ *        closed by close(), or by the finaliser when the channel is 
+ *        collected, so that abandoned channels do not exhaust the handles.
+****************************************************************************/
+STATIC mp_obj_t microamp_py_channel_make_new(const mp_obj_type_t* type, size_t n_args, size_t n_kw, const mp_obj_t* args)
+{
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    int nhandle = microamp_open(g_microamp_state,mp_obj_str_get_str(args[0]));
+    if ( nhandle < 0 )
+        mp_raise_OSError(MP_ENOENT);
+    microamp_py_channel_obj_t* self = m_new_obj_with_finaliser(microamp_py_channel_obj_t);
+    self->base.type = &microamp_py_channel_type;
+    self->nhandle = nhandle;
+    self->wrneed = 0;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+/** *************************************************************************   
+ * \brief Non-blocking stream read of up to @size bytes.
+****************************************************************************/
+STATIC mp_uint_t microamp_py_channel_read(mp_obj_t self_in, void* buf, mp_uint_t size, int* errcode)
+{
+    microamp_py_channel_obj_t* self = MP_OBJ_TO_PTR(self_in);
+    int avail = microamp_avail(g_microamp_state,self->nhandle);
+    if ( size == 0 && avail >= 0 )
+        return 0;
+    if ( avail < 0 )
+    {
+        *errcode = MP_EBADF;
+        return MP_STREAM_ERROR;
+    }
+    if ( avail == 0 )
+    {
+        *errcode = MP_EAGAIN;
+        return MP_STREAM_ERROR;
+    }
+    int rc = microamp_read(g_microamp_state,self->nhandle,buf,(mp_uint_t)avail < size ? (mp_uint_t)avail : size);
+    if ( rc < 0 )
+    {
+        *errcode = MP_EIO;
+        return MP_STREAM_ERROR;
+    }
+    return rc;
+}
+
+/** *************************************************************************   
+ * \brief Non-blocking stream write of up to @size bytes. On a MODE_MSG 
+ *        or queue endpoint the whole buffer is one message, written 
+ *        entire or not at all, never split to fit the free space. A 
+ *        message which can never fit fails with EIO rather than EAGAIN, 
+ *        and one which does not fit yet is remembered so that 
+ *        MP_STREAM_POLL_WR waits for room for all of it.
+****************************************************************************/
+STATIC mp_uint_t microamp_py_channel_write(mp_obj_t self_in, const void* buf, mp_uint_t size, int* errcode)
+{
+    microamp_py_channel_obj_t* self = MP_OBJ_TO_PTR(self_in);
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(g_microamp_state,self->nhandle);
+    int space = microamp_space(g_microamp_state,self->nhandle);
+    bool record;
+    if ( endpoint == NULL || space < 0 )
+    {
+        *errcode = MP_EBADF;
+        return MP_STREAM_ERROR;
+    }
+    if ( size == 0 )
+        return 0;
+    record = (endpoint->flags & (MICROAMP_MODE_MSG|MICROAMP_MODE_MPMC)) != 0;
+    if ( record && size > microamp_py_channel_maxmsg(endpoint) )
+    {
+        *errcode = MP_EIO;
+        return MP_STREAM_ERROR;
+    }
+    if ( space == 0 || (record && (mp_uint_t)space < size) )
+    {
+        self->wrneed = record ? size : 0;
+        *errcode = MP_EAGAIN;
+        return MP_STREAM_ERROR;
+    }
+    if ( !record && (mp_uint_t)space < size )
+        size = space;
+    int rc = microamp_write(g_microamp_state,self->nhandle,buf,size);
+    if ( rc < 0 )
+    {
+        self->wrneed = record && rc == MICROAMP_ERR_OVRFL ? size : 0;
+        *errcode = rc == MICROAMP_ERR_OVRFL ? MP_EAGAIN : MP_EIO;
+        return MP_STREAM_ERROR;
+    }
+    self->wrneed = 0;
+    return rc;
+}
+
+/** *************************************************************************   
+ * \brief MP_STREAM_POLL readiness from the ring occupancy, and close. 
+ *        Writable means room for the message a write last had to refuse, 
+ *        otherwise for at least one byte, record or slot.
+****************************************************************************/
+STATIC mp_uint_t microamp_py_channel_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int* errcode)
+{
+    microamp_py_channel_obj_t* self = MP_OBJ_TO_PTR(self_in);
+    if ( request == MP_STREAM_POLL )
+    {
+        mp_uint_t ret = 0;
+        if ( self->nhandle < 0 )
+            return MP_STREAM_POLL_ERR;
+        if ( (arg & MP_STREAM_POLL_RD) && microamp_avail(g_microamp_state,self->nhandle) > 0 )
+            ret |= MP_STREAM_POLL_RD;
+        if ( (arg & MP_STREAM_POLL_WR) && 
+             microamp_space(g_microamp_state,self->nhandle) >= (int)(self->wrneed ? self->wrneed : 1) )
+            ret |= MP_STREAM_POLL_WR;
+        return ret;
+    }
+    else if ( request == MP_STREAM_CLOSE )
+    {
+        if ( self->nhandle >= 0 )
+        {
+            microamp_close(g_microamp_state,self->nhandle);
+            self->nhandle = -1;
+        }
+        return 0;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+/** *************************************************************************   
+ * \return The channel handle, for use with the channel_xxx functions.
+****************************************************************************/
+STATIC mp_obj_t microamp_py_channel_handle(mp_obj_t self_in)
+{
+    microamp_py_channel_obj_t* self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_int(self->nhandle);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microamp_py_channel_handle_obj, microamp_py_channel_handle);
+
+STATIC const mp_rom_map_elem_t microamp_py_channel_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&mp_stream_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&mp_stream_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_handle), MP_ROM_PTR(&microamp_py_channel_handle_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(microamp_py_channel_locals_dict, microamp_py_channel_locals_dict_table);
+
+STATIC const mp_stream_p_t microamp_py_channel_stream_p = {
+    .read = microamp_py_channel_read,
+    .write = microamp_py_channel_write,
+    .ioctl = microamp_py_channel_ioctl,
+};
+
+const mp_obj_type_t microamp_py_channel_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Channel,
+    .make_new = microamp_py_channel_make_new,
+    .getiter = mp_identity_getiter,
+    .iternext = mp_stream_unbuffered_iter,
+    .protocol = &microamp_py_channel_stream_p,
+    .locals_dict = (mp_obj_dict_t*)&microamp_py_channel_locals_dict,
+};
 
 
 /** *************************************************************************   
@@ -393,21 +808,40 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_3(microamp_py_dataempty_handler_obj, microamp_py_
 STATIC const mp_rom_map_elem_t microamp_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_microamp) },
     { MP_ROM_QSTR(MP_QSTR_endpoint_create), MP_ROM_PTR(&microamp_py_create_obj) },
+    { MP_ROM_QSTR(MP_QSTR_endpoint_create_queue), MP_ROM_PTR(&microamp_py_create_queue_obj) },
     { MP_ROM_QSTR(MP_QSTR_endpoint_indexof), MP_ROM_PTR(&microamp_py_indexof_obj) },
     { MP_ROM_QSTR(MP_QSTR_endpoint_count), MP_ROM_PTR(&microamp_py_count_obj) },
     { MP_ROM_QSTR(MP_QSTR_endpoint_at), MP_ROM_PTR(&microamp_py_at_obj) },
+    { MP_ROM_QSTR(MP_QSTR_endpoint_destroy), MP_ROM_PTR(&microamp_py_destroy_obj) },
+    { MP_ROM_QSTR(MP_QSTR_Channel), MP_ROM_PTR(&microamp_py_channel_type) },
     { MP_ROM_QSTR(MP_QSTR_channel_open), MP_ROM_PTR(&microamp_py_open_obj) },
     { MP_ROM_QSTR(MP_QSTR_channel_close), MP_ROM_PTR(&microamp_py_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_channel_subscribe), MP_ROM_PTR(&microamp_py_subscribe_obj) },
     { MP_ROM_QSTR(MP_QSTR_channel_lock), MP_ROM_PTR(&microamp_py_lock_obj) },
     { MP_ROM_QSTR(MP_QSTR_channel_unlock), MP_ROM_PTR(&microamp_py_unlock_obj) },
     { MP_ROM_QSTR(MP_QSTR_channel_trylock), MP_ROM_PTR(&microamp_py_trylock_obj) },
     { MP_ROM_QSTR(MP_QSTR_channel_read), MP_ROM_PTR(&microamp_py_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_channel_readinto), MP_ROM_PTR(&microamp_py_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_channel_write), MP_ROM_PTR(&microamp_py_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_channel_get), MP_ROM_PTR(&microamp_py_get_obj) },
     { MP_ROM_QSTR(MP_QSTR_channel_put), MP_ROM_PTR(&microamp_py_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_channel_recv), MP_ROM_PTR(&microamp_py_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_channel_send), MP_ROM_PTR(&microamp_py_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_channel_peek), MP_ROM_PTR(&microamp_py_peek_obj) },
+    { MP_ROM_QSTR(MP_QSTR_channel_skip), MP_ROM_PTR(&microamp_py_skip_obj) },
     { MP_ROM_QSTR(MP_QSTR_channel_avail), MP_ROM_PTR(&microamp_py_avail_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&microamp_py_stats_obj) },
     { MP_ROM_QSTR(MP_QSTR_channel_dataready_handler), MP_ROM_PTR(&microamp_py_dataready_handler_obj) },
     { MP_ROM_QSTR(MP_QSTR_channel_dataempty_handler), MP_ROM_PTR(&microamp_py_dataempty_handler_obj) },
+    { MP_ROM_QSTR(MP_QSTR_MODE_STREAM), MP_ROM_INT(MICROAMP_MODE_STREAM) },
+    { MP_ROM_QSTR(MP_QSTR_MODE_SPSC), MP_ROM_INT(MICROAMP_MODE_SPSC) },
+    { MP_ROM_QSTR(MP_QSTR_MODE_MSG), MP_ROM_INT(MICROAMP_MODE_MSG) },
+    { MP_ROM_QSTR(MP_QSTR_MODE_BCAST), MP_ROM_INT(MICROAMP_MODE_BCAST) },
+    { MP_ROM_QSTR(MP_QSTR_MODE_DROP), MP_ROM_INT(MICROAMP_MODE_DROP) },
+    { MP_ROM_QSTR(MP_QSTR_MODE_POW2), MP_ROM_INT(MICROAMP_MODE_POW2) },
+    #if defined(MICROAMP_HOST)
+    { MP_ROM_QSTR(MP_QSTR_host_attach), MP_ROM_PTR(&microamp_py_host_attach_obj) },
+    #endif
 };
 STATIC MP_DEFINE_CONST_DICT(microamp_module_globals, microamp_module_globals_table);
 
@@ -8,3 +8,11 @@ SRC_USERMOD += $(MICROAMP_MOD_DIR)/../../src/microamp_c.c
 # This is not actually needed in this example.
 CFLAGS_USERMOD += -I$(MICROAMP_MOD_DIR) -I$(MICROAMP_MOD_DIR)/../../src -ggdb
 CMICROAMP_MOD_DIR := $(USERMOD_DIR)
+
+# MICROAMP_HOST=1 builds for the unix port, against a shared region created 
+# by a host side process (see host/), in place of the target's shared RAM.
+ifeq ($(MICROAMP_HOST),1)
+SRC_USERMOD += $(MICROAMP_MOD_DIR)/../../src/microamp_host.c
+SRC_USERMOD += $(MICROAMP_MOD_DIR)/../../host/brisc_host.c
+CFLAGS_USERMOD += -DMICROAMP_HOST -I$(MICROAMP_MOD_DIR)/../../host
+endif
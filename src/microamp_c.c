@@ -28,29 +28,138 @@ SOFTWARE.
 
 ****************************************************************************/
 #include "microamp_c.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define microamp_malloc         m_malloc
+#define microamp_realloc        m_realloc
+#define microamp_free           m_free
+
+#if defined(MICROAMP_HOST)
+
+#include "microamp_host.h"
+
+#define microamp_shmem_base()   microamp_host_shmem_base()
+#define microamp_shmem_size()   microamp_host_shmem_size()
+#define microamp_shmem_pagesz() ((size_t)4096)
+#define microamp_shmem_pages()  (microamp_shmem_size()/microamp_shmem_pagesz())
+#if !defined(microamp_cycles)
+#define microamp_cycles()       microamp_host_cycles()
+#endif
+
+#else
+
 extern cpu_reg_t    __microamp_pages__;
 extern cpu_reg_t    __microamp_page_size__;
 extern cpu_reg_t    __microamp_shared_ram__;
 extern cpu_reg_t    __microamp_shared_size__;
 
-#define microamp_malloc         m_malloc
-#define microamp_realloc        m_realloc
-#define microamp_free           m_free
-
 #define microamp_shmem_base()   ((void*)&__microamp_shared_ram__)
 #define microamp_shmem_size()   ((size_t)&__microamp_shared_size__)
 #define microamp_shmem_pages()  ((size_t)&__microamp_pages__)
 #define microamp_shmem_pagesz() ((size_t)&__microamp_page_size__)
-#define microamp_shmem_page(n)  ((size_t)microamp_shmem_base()+(microamp_shmem_pagesz()*(n)))
+
+#endif
+#define microamp_shmem_align(n) (((n)+(MICROAMP_SHMEM_ALIGN-1)) & ~((size_t)MICROAMP_SHMEM_ALIGN-1))
+
+#if !defined(microamp_thread_yield)
+#define microamp_thread_yield() b_thread_yield()
+#endif
+#if !defined(microamp_systick)
+#define microamp_systick()      ((uint32_t)b_thread_systick())
+#endif
+
+/** A fine time base for lock_wait and the trace. A port with a cycle 
+ *  counter should define it, otherwise it falls back to microamp_systick() 
+ *  at the cost of resolution. */
+#if !defined(microamp_cycles)
+#if defined(__riscv)
+#define microamp_cycles()       ({ uint32_t _c; __asm__ volatile("csrr %0, mcycle" : "=r"(_c)); _c; })
+#else
+#define microamp_cycles()       microamp_systick()
+#endif
+#endif
+
+#if !defined(microamp_trace_time)
+#define microamp_trace_time()   microamp_cycles()   /**< trace time stamp */
+#endif
+
+#if !defined(MICROAMP_DOORBELL_SLICE)
+#define MICROAMP_DOORBELL_SLICE 10  /**< Longest doorbell sleep between wake checks */
+#endif
+
+#define microamp_load_acquire(p)    __atomic_load_n((p),__ATOMIC_ACQUIRE)
+#define microamp_store_release(p,v) __atomic_store_n((p),(v),__ATOMIC_RELEASE)
+#define microamp_stat_inc(p)        __atomic_fetch_add((p),1,__ATOMIC_RELAXED)
+#define microamp_stat_add(p,n)      __atomic_fetch_add((p),(n),__ATOMIC_RELAXED)
+
+#define MICROAMP_LEVEL_ABOVE    0x01  /**< avail >= the dataready watermark */
+#define MICROAMP_LEVEL_BELOW    0x02  /**< avail <= the dataempty watermark */
+
+#define MICROAMP_MSG_HDR        sizeof(uint32_t)  /**< MICROAMP_MODE_MSG record length prefix */
+
+#define MICROAMP_MODE_LOCKFREE  (MICROAMP_MODE_SPSC|MICROAMP_MODE_MPMC)  /**< no data path lock */
+#define MICROAMP_MODE_RECORD    (MICROAMP_MODE_MSG|MICROAMP_MODE_MPMC)   /**< no byte level access */
+
+/** *************************************************************************  
+ * \brief A MICROAMP_MODE_MPMC slot header, the message follows it.
+****************************************************************************/
+typedef struct _microamp_slot_
+{
+    uint32_t                seq;
+    uint32_t                len;
+} microamp_slot_t;
+
+#define microamp_slot_stride(slotsz)    ((sizeof(microamp_slot_t)+(slotsz)+7) & ~(size_t)7)
+#define microamp_slot_at(endpoint,pos)  ((microamp_slot_t*)((endpoint)->shmembase + \
+                                            ((pos) & ((endpoint)->nslots-1)) * microamp_slot_stride((endpoint)->slotsz)))
+
+#define MICROAMP_NAME_EMPTY     0     /**< name_index bucket never used */
+#define MICROAMP_NAME_TOMB      (-1)  /**< name_index bucket vacated, probe on */
+
+#if (MICROAMP_NAME_BUCKETS & (MICROAMP_NAME_BUCKETS-1)) || MICROAMP_NAME_BUCKETS <= MICROAMP_MAX_ENDPOINT
+#error MICROAMP_NAME_BUCKETS must be a power of 2 greater than MICROAMP_MAX_ENDPOINT
+#endif
+#if (MICROAMP_SHMEM_ALIGN & (MICROAMP_CACHE_LINE-1)) || (MICROAMP_CACHE_LINE & (MICROAMP_CACHE_LINE-1))
+#error MICROAMP_SHMEM_ALIGN must be a multiple of MICROAMP_CACHE_LINE, a power of 2
+#endif
+#if MICROAMP_MAX_HANDLE > (1<<MICROAMP_HANDLE_BITS)
+#error MICROAMP_MAX_HANDLE does not fit in MICROAMP_HANDLE_BITS
+#endif
 
 static microamp_endpoint_t* microamp_new_endpoint(microamp_state_t* microamp_state);
+static int microamp_create_endpoint(microamp_state_t* microamp_state,const char* name,size_t size,int flags);
+static void microamp_free_endpoint(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint);
 static int microamp_get_empty_handle(microamp_state_t* microamp_state);
+static void microamp_put_empty_handle(microamp_state_t* microamp_state,int slot);
 static int microamp_lookup(microamp_state_t* microamp_state,const char* name);
-static int microamp_ring_put(size_t head, size_t tail, uint8_t* buf, size_t size, uint8_t ch);
-static int microamp_ring_get(size_t head, size_t tail, const uint8_t* buf, size_t size, uint8_t* ch);
+static uint32_t microamp_name_hash(const char* name);
+static void microamp_name_insert(microamp_state_t* microamp_state,int index);
+static void microamp_name_remove(microamp_state_t* microamp_state,int index);
+static int microamp_shmem_alloc(microamp_state_t* microamp_state,size_t size,size_t* shmembase);
+static size_t microamp_ring_used(const microamp_endpoint_t* endpoint, size_t head, size_t tail);
+static size_t microamp_ring_free(const microamp_endpoint_t* endpoint, size_t head, size_t tail);
+static size_t microamp_ring_capacity(const microamp_endpoint_t* endpoint);
+static size_t microamp_ring_offset(const microamp_endpoint_t* endpoint, size_t pos);
+static size_t microamp_ring_advance(const microamp_endpoint_t* endpoint, size_t pos, size_t size);
+static size_t microamp_ring_contig(const microamp_endpoint_t* endpoint, size_t head, size_t tail);
+static size_t microamp_ring_copyin(microamp_endpoint_t* endpoint, size_t head, const void* buf, size_t size);
+static size_t microamp_ring_copyout(const microamp_endpoint_t* endpoint, size_t tail, void* buf, size_t size);
+static void microamp_endpoint_lock(microamp_endpoint_t* endpoint);
+static void microamp_endpoint_unlock(microamp_endpoint_t* endpoint);
+static void microamp_notify(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint);
+static int microamp_endpoint_readv(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint,size_t* cursor,const microamp_iovec_t* iov,int iovcnt);
+static int microamp_endpoint_writev(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint,const microamp_iovec_t* iov,int iovcnt);
+static void microamp_stat_peak(microamp_endpoint_t* endpoint,size_t head,size_t tail);
+static size_t microamp_endpoint_used(microamp_endpoint_t* endpoint);
+static int microamp_queue_readv(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint,const microamp_iovec_t* iov,int iovcnt);
+static int microamp_queue_writev(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint,const microamp_iovec_t* iov,int iovcnt);
+static int microamp_queue_avail(microamp_endpoint_t* endpoint);
+static int microamp_wait(microamp_endpoint_t* endpoint,uint32_t seq,uint32_t start,uint32_t timeout);
+static size_t* microamp_handle_cursor(microamp_state_t* microamp_state,int nhandle,microamp_endpoint_t* endpoint);
+static void microamp_bcast_slowest(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint);
+static void microamp_bcast_drop(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint,size_t need);
 
 /** *************************************************************************  
  * \note \ref g_microamp_state is Kind of a dirty hack for now to provide a 
@@ -58,62 +167,127 @@ static int microamp_ring_get(size_t head, size_t tail, const uint8_t* buf, size_
 ****************************************************************************/
 microamp_state_t* g_microamp_state=NULL;
 
+/** *************************************************************************  
+ * \note The doorbell is per core, not per state, each side installs 
+ * its own means of reaching the other.
+****************************************************************************/
+static const microamp_doorbell_t* microamp_doorbell=NULL;
+
+#if defined(MICROAMP_TRACE)
+_Static_assert((MICROAMP_TRACE_SIZE & (MICROAMP_TRACE_SIZE-1)) == 0,"MICROAMP_TRACE_SIZE must be a power of 2");
+_Static_assert(MICROAMP_TRACE_SIZE > 0 && MICROAMP_TRACE_SIZE <= UINT16_MAX,"MICROAMP_TRACE_SIZE must fit microamp_trace_t.size");
+
+/** *************************************************************************  
+ * \note Per core, not static so that a debugger can find it by name.
+****************************************************************************/
+microamp_trace_t microamp_trace = { MICROAMP_TRACE_MAGIC, MICROAMP_TRACE_CORE, MICROAMP_TRACE_SIZE };
+#endif
+
 
 /** *************************************************************************  
 *************************** Poll For I/O Events ***************************** 
 ****************************************************************************/
 void microamp_poll_hook(void)
 {
-
-    for(int nenadpoint=0; nenadpoint < g_microamp_state->endpointcnt; nenadpoint++)
+    for(int word=0; word < MICROAMP_PENDING_WORDS; word++)
     {
-        volatile microamp_endpoint_t* endpoint = &g_microamp_state->endpoint[nenadpoint];
-        
-        // /** Handle the Python-side events */
-        // if ( endpoint->dataready_event.py_fn || endpoint->dataempty_event.py_fn )
-        // {
-        //     size_t avail;
-            
-        //     b_mutex_lock((brisc_mutex_t*)&endpoint->mutex);
-        //     avail = microamp_ring_avail(endpoint->head,endpoint->tail,endpoint->shmemsz);
-        //     endpoint->dataempty = !avail;
-        //     b_mutex_unlock((brisc_mutex_t*)&endpoint->mutex);
-
-        //     if ( avail && endpoint->dataready_event.py_fn )
-        //     {
-        //         mp_call_function_1(endpoint->dataready_event.py_fn,endpoint->dataready_event.py_arg);
-        //     }
-
-        //     if ( !avail && endpoint->dataempty && endpoint->dataempty_event.py_fn )
-        //     {
-        //         mp_call_function_1(endpoint->dataempty_event.py_fn,endpoint->dataempty_event.py_arg);
-        //     }
-        // }
-
-        /** Handle the 'C' side events */
-        if ( (endpoint->dataready_event.c_fn || endpoint->dataempty_event.c_fn) )
+        uint32_t pending = microamp_pending_take(g_microamp_state,MICROAMP_HOOK_C,word);
+        while ( pending )
         {
-            size_t avail;
-            
-            b_mutex_lock((brisc_mutex_t*)&endpoint->mutex);
-            avail = microamp_ring_avail(endpoint->head,endpoint->tail,endpoint->shmemsz);
-            endpoint->dataempty = !avail;
-            b_mutex_unlock((brisc_mutex_t*)&endpoint->mutex);
-
-            if ( avail && endpoint->dataready_event.c_fn )
+            int nendpoint = (word*32) + __builtin_ctz(pending);
+            volatile microamp_endpoint_t* endpoint = &g_microamp_state->endpoint[nendpoint];
+            int events;
+            pending &= pending-1;
+            if ( endpoint->ctrl == NULL )
+                continue;
+            events = microamp_poll_events(g_microamp_state,MICROAMP_HOOK_C,nendpoint);
+            microamp_trace_event(MICROAMP_TRACE_POLL,nendpoint,events);
+
+            /** Handle the 'C' side events */
+            if ( (events & MICROAMP_EVENT_READY) && endpoint->dataready_event.c_fn )
             {
+                microamp_stat_inc(&endpoint->ctrl->callbacks);
+                microamp_trace_event(MICROAMP_TRACE_CB_ENTER,nendpoint,MICROAMP_EVENT_READY);
                 endpoint->dataready_event.c_fn(endpoint->dataready_event.c_arg);
+                microamp_trace_event(MICROAMP_TRACE_CB_EXIT,nendpoint,MICROAMP_EVENT_READY);
             }
 
-            if ( !avail && endpoint->dataempty && endpoint->dataempty_event.c_fn )
+            if ( (events & MICROAMP_EVENT_EMPTY) && endpoint->dataempty_event.c_fn )
             {
+                microamp_stat_inc(&endpoint->ctrl->callbacks);
+                microamp_trace_event(MICROAMP_TRACE_CB_ENTER,nendpoint,MICROAMP_EVENT_EMPTY);
                 endpoint->dataempty_event.c_fn(endpoint->dataempty_event.c_arg);
+                microamp_trace_event(MICROAMP_TRACE_CB_EXIT,nendpoint,MICROAMP_EVENT_EMPTY);
             }
         }
+    }
+}
 
-
+int microamp_poll_events(microamp_state_t* microamp_state,int hook,int nendpoint)
+{
+    microamp_endpoint_t* endpoint = &microamp_state->endpoint[nendpoint];
+    size_t avail, rx_watermark, tx_low_watermark;
+    uint8_t was, now = 0;
+    if ( endpoint->ctrl == NULL )
+        return 0;
+    was = endpoint->ctrl->level[hook];
+    if ( hook == MICROAMP_HOOK_PY )
+    {
+        rx_watermark = endpoint->dataready_event.py_watermark;
+        tx_low_watermark = endpoint->dataempty_event.py_watermark;
+    }
+    else
+    {
+        rx_watermark = endpoint->dataready_event.c_watermark;
+        tx_low_watermark = endpoint->dataempty_event.c_watermark;
     }
+    avail = microamp_endpoint_used(endpoint);
+    if ( avail >= (rx_watermark ? rx_watermark : 1) )
+        now |= MICROAMP_LEVEL_ABOVE;
+    if ( avail <= tx_low_watermark )
+        now |= MICROAMP_LEVEL_BELOW;
+    endpoint->ctrl->level[hook] = now;
+    return ((now & ~was & MICROAMP_LEVEL_ABOVE) ? MICROAMP_EVENT_READY : 0) |
+           ((now & ~was & MICROAMP_LEVEL_BELOW) ? MICROAMP_EVENT_EMPTY : 0);
+}
+
+uint32_t microamp_pending_take(microamp_state_t* microamp_state,int hook,int word)
+{
+    return __atomic_exchange_n(&microamp_state->pending[hook][word],0,__ATOMIC_ACQ_REL);
+}
+
+void microamp_pending_set(microamp_state_t* microamp_state,int hook,int nendpoint)
+{
+    __atomic_fetch_or(&microamp_state->pending[hook][nendpoint/32],1UL<<(nendpoint%32),__ATOMIC_RELEASE);
+}
+
+
+void microamp_set_doorbell(const microamp_doorbell_t* doorbell)
+{
+    microamp_doorbell = doorbell;
+}
+
+int microamp_doorbell_wait(uint32_t timeout)
+{
+    const microamp_doorbell_t* doorbell = microamp_doorbell;
+    if ( doorbell == NULL || doorbell->wait == NULL )
+        return MICROAMP_ERR_NONE;
+    return doorbell->wait(doorbell->arg,timeout);
+}
+
+#if defined(MICROAMP_TRACE)
+void microamp_trace_record(int event,int nendpoint,size_t bytes)
+{
+    uint32_t seq = __atomic_fetch_add(&microamp_trace.head,1,__ATOMIC_RELAXED)+1;
+    microamp_trace_rec_t* rec = &microamp_trace.rec[(seq-1) & (MICROAMP_TRACE_SIZE-1)];
+    __atomic_store_n(&rec->seq,0,__ATOMIC_RELAXED);
+    rec->time = microamp_trace_time();
+    rec->event = event;
+    rec->endpoint = nendpoint;
+    rec->bytes = bytes;
+    __atomic_store_n(&rec->seq,seq,__ATOMIC_RELEASE);
 }
+#endif
 
 
 /** *************************************************************************  
@@ -123,6 +297,14 @@ void microamp_poll_hook(void)
 void microamp_init(microamp_state_t* microamp_state)
 {
     memset(microamp_state,0,sizeof(microamp_state_t));
+    for(int slot=0; slot < MICROAMP_MAX_HANDLE; slot++)
+        microamp_state->handle[slot].next = slot+1 < MICROAMP_MAX_HANDLE ? slot+1 : -1;
+    microamp_state->handle_free = 0;
+    g_microamp_state=microamp_state;
+}
+
+void microamp_attach(microamp_state_t* microamp_state)
+{
     g_microamp_state=microamp_state;
 }
 
@@ -145,7 +327,7 @@ int microamp_count(microamp_state_t* microamp_state)
 
 const char* microamp_at(microamp_state_t* microamp_state,int index)
 {
-    if ( index < microamp_state->endpointcnt )
+    if ( index >= 0 && index < microamp_state->endpointcnt && microamp_state->endpoint[index].name[0] )
     {
         microamp_endpoint_t* endpoint = &microamp_state->endpoint[index];
         return (const char*)endpoint->name;
@@ -155,28 +337,45 @@ const char* microamp_at(microamp_state_t* microamp_state,int index)
 
 int microamp_create(microamp_state_t* microamp_state,const char* name,size_t size)
 {
-    if ( size <= microamp_shmem_pagesz() )
+    return microamp_create_ex(microamp_state,name,size,MICROAMP_MODE_STREAM);
+}
+
+int microamp_create_ex(microamp_state_t* microamp_state,const char* name,size_t size,int flags)
+{
+    int index;
+    if ( flags & ~(MICROAMP_MODE_SPSC|MICROAMP_MODE_MSG|MICROAMP_MODE_BCAST|MICROAMP_MODE_DROP|MICROAMP_MODE_POW2) )
+        return MICROAMP_ERR_INVAL;
+    if ( (flags & MICROAMP_MODE_POW2) && (size == 0 || (size & (size-1)) || size > 0x80000000) )
+        return MICROAMP_ERR_INVAL;
+    if ( (flags & MICROAMP_MODE_BCAST) ? (flags & MICROAMP_MODE_SPSC) : (flags & MICROAMP_MODE_DROP) )
+        return MICROAMP_ERR_INVAL;
+
+    b_mutex_lock(&microamp_state->mutex);
+    index = microamp_create_endpoint(microamp_state,name,size,flags);
+    b_mutex_unlock(&microamp_state->mutex);
+    return index;
+}
+
+int microamp_create_queue(microamp_state_t* microamp_state,const char* name,size_t slotsz,size_t nslots)
+{
+    int index;
+    if ( slotsz == 0 || slotsz > UINT32_MAX || nslots < 2 || (nslots & (nslots-1)) || nslots > 0x80000000 )
+        return MICROAMP_ERR_INVAL;
+    if ( nslots > microamp_shmem_size()/microamp_slot_stride(slotsz) )
+        return MICROAMP_ERR_RES;
+
+    b_mutex_lock(&microamp_state->mutex);
+    index = microamp_create_endpoint(microamp_state,name,nslots*microamp_slot_stride(slotsz),MICROAMP_MODE_MPMC);
+    if ( index >= 0 )
     {
-        b_mutex_lock(&microamp_state->mutex);
-        if ( microamp_lookup(microamp_state,name) == MICROAMP_ERR_NONE )
-        {
-            microamp_endpoint_t* endpoint = microamp_new_endpoint(microamp_state);
-            if ( endpoint != NULL )
-            {
-                int index = microamp_state->endpointcnt-1;
-                strncpy(endpoint->name,name,MICROAMP_MAX_NAME);
-                endpoint->shmembase = microamp_shmem_page(index);
-                endpoint->shmemsz = size;
-                b_mutex_unlock(&microamp_state->mutex);
-                return index;
-            }
-            b_mutex_unlock(&microamp_state->mutex);
-            return MICROAMP_ERR_RES;
-        }
-        b_mutex_unlock(&microamp_state->mutex);
-        return MICROAMP_ERR_DUP;
+        microamp_endpoint_t* endpoint = &microamp_state->endpoint[index];
+        endpoint->slotsz = slotsz;
+        endpoint->nslots = nslots;
+        for(size_t pos=0; pos < nslots; pos++)
+            microamp_slot_at(endpoint,pos)->seq = pos;
     }
-    return MICROAMP_ERR_RES;
+    b_mutex_unlock(&microamp_state->mutex);
+    return index;
 }
 
 int microamp_open(microamp_state_t* microamp_state,const char* name)
@@ -185,33 +384,74 @@ int microamp_open(microamp_state_t* microamp_state,const char* name)
     int nendpoint = microamp_lookup(microamp_state,name);
     if ( nendpoint >= 0 )
     {
-        int nhandle = microamp_get_empty_handle(microamp_state);
-        if ( nhandle >= 0 )
+        int slot = microamp_get_empty_handle(microamp_state);
+        if ( slot >= 0 )
         {
-            microamp_handle_t* handle = &microamp_state->handle[nhandle];
+            microamp_handle_t* handle = &microamp_state->handle[slot];
             handle->endpoint = &microamp_state->endpoint[nendpoint];
             handle->endpoint->nrefs++;
             b_mutex_unlock(&microamp_state->mutex);
-            return nhandle;
+            return (int)(handle->gen << MICROAMP_HANDLE_BITS) | slot;
         }
     }
     b_mutex_unlock(&microamp_state->mutex);
     return MICROAMP_ERR_NONE;
 }
 
+int microamp_subscribe(microamp_state_t* microamp_state,int nhandle)
+{
+    int slot = nhandle & MICROAMP_HANDLE_MASK;
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_NONE;
+    if ( !(endpoint->flags & MICROAMP_MODE_BCAST) )
+        return MICROAMP_ERR_PROT;
+
+    microamp_endpoint_lock(endpoint);
+    microamp_state->handle[slot].tail = endpoint->ctrl->head;
+    endpoint->readers[slot/32] |= 1u << (slot%32);
+    microamp_bcast_slowest(microamp_state,endpoint);
+    microamp_endpoint_unlock(endpoint);
+    return 0;
+}
+
+int microamp_destroy(microamp_state_t* microamp_state,const char* name)
+{
+    b_mutex_lock(&microamp_state->mutex);
+    int nendpoint = microamp_lookup(microamp_state,name);
+    if ( nendpoint >= 0 )
+    {
+        microamp_endpoint_t* endpoint = &microamp_state->endpoint[nendpoint];
+        endpoint->destroyed = true;
+        microamp_name_remove(microamp_state,nendpoint);
+        if ( endpoint->nrefs == 0 )
+            microamp_free_endpoint(microamp_state,endpoint);
+        b_mutex_unlock(&microamp_state->mutex);
+        return 0;
+    }
+    b_mutex_unlock(&microamp_state->mutex);
+    return MICROAMP_ERR_NONE;
+}
+
 int microamp_close(microamp_state_t* microamp_state,int nhandle)
 {
     b_mutex_lock(&microamp_state->mutex);
-    if ( nhandle >= 0 && nhandle < MICROAMP_MAX_HANDLE )
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint != NULL && endpoint->nrefs > 0 )
     {
-        microamp_handle_t* handle = &microamp_state->handle[nhandle];
-        if ( handle->endpoint != NULL && handle->endpoint->nrefs > 0 )
+        int slot = nhandle & MICROAMP_HANDLE_MASK;
+        if ( endpoint->readers[slot/32] & (1u << (slot%32)) )
         {
-            --handle->endpoint->nrefs;
-            memset(handle,0,sizeof(microamp_handle_t));
-            b_mutex_unlock(&microamp_state->mutex);
-            return 0;
+            microamp_endpoint_lock(endpoint);
+            endpoint->readers[slot/32] &= ~(1u << (slot%32));
+            microamp_bcast_slowest(microamp_state,endpoint);
+            microamp_endpoint_unlock(endpoint);
         }
+        if ( --endpoint->nrefs == 0 && endpoint->destroyed )
+            microamp_free_endpoint(microamp_state,endpoint);
+        microamp_put_empty_handle(microamp_state,nhandle & MICROAMP_HANDLE_MASK);
+        b_mutex_unlock(&microamp_state->mutex);
+        return 0;
     }
     b_mutex_unlock(&microamp_state->mutex);
     return MICROAMP_ERR_NONE;
@@ -219,10 +459,10 @@ int microamp_close(microamp_state_t* microamp_state,int nhandle)
 
 extern int microamp_lock(microamp_state_t* microamp_state,int nhandle)
 {
-    microamp_handle_t* handle = &microamp_state->handle[nhandle];
-    if ( handle->endpoint != NULL )
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint != NULL )
     {
-        b_mutex_lock(&handle->endpoint->mutex);
+        b_mutex_lock(&endpoint->ctrl->user_mutex);
         return 0;
     }
     return MICROAMP_ERR_NONE;
@@ -230,10 +470,10 @@ extern int microamp_lock(microamp_state_t* microamp_state,int nhandle)
 
 extern int microamp_unlock(microamp_state_t* microamp_state,int nhandle)
 {
-    microamp_handle_t* handle = &microamp_state->handle[nhandle];
-    if ( handle->endpoint != NULL )
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint != NULL )
     {
-        b_mutex_unlock(&handle->endpoint->mutex);
+        b_mutex_unlock(&endpoint->ctrl->user_mutex);
         return 0;
     }
     return MICROAMP_ERR_NONE;
@@ -241,111 +481,308 @@ extern int microamp_unlock(microamp_state_t* microamp_state,int nhandle)
 
 extern int microamp_trylock(microamp_state_t* microamp_state,int nhandle)
 {
-    microamp_handle_t* handle = &microamp_state->handle[nhandle];
-    if ( handle->endpoint != NULL )
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint != NULL )
     {
-        return b_mutex_try_lock(&handle->endpoint->mutex) ? MICROAMP_ERR_BLOCK : 0;
+        return b_mutex_try_lock(&endpoint->ctrl->user_mutex) ? MICROAMP_ERR_BLOCK : 0;
     }
     return MICROAMP_ERR_NONE;
 }
 
 extern int microamp_read(microamp_state_t* microamp_state,int nhandle,void* buf,size_t size)
 {
-    microamp_handle_t* handle;
-    b_mutex_lock(&microamp_state->mutex);
-    if ( nhandle >= 0 && nhandle < MICROAMP_MAX_HANDLE )
+    microamp_iovec_t iov = { buf, size };
+    return microamp_readv(microamp_state,nhandle,&iov,1);
+}
+
+extern int microamp_write(microamp_state_t* microamp_state,int nhandle,const void* buf,size_t size)
+{
+    microamp_iovec_t iov = { (void*)buf, size };
+    return microamp_writev(microamp_state,nhandle,&iov,1);
+}
+
+extern int microamp_read_wait(microamp_state_t* microamp_state,int nhandle,void* buf,size_t size,uint32_t timeout)
+{
+    int rc;
+    uint32_t start = microamp_systick();
+    size_t* cursor;
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_NONE;
+    if ( (cursor=microamp_handle_cursor(microamp_state,nhandle,endpoint)) == NULL )
+        return MICROAMP_ERR_PROT;
+    if ( !(endpoint->flags & MICROAMP_MODE_RECORD) && size > microamp_ring_capacity(endpoint) )
+        return MICROAMP_ERR_UNDFL;
+
+    __atomic_fetch_add(&endpoint->ctrl->waiters,1,__ATOMIC_ACQ_REL);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);  /**< pairs with microamp_notify() */
+    for(int tries=0; ; tries++)
     {
-        handle = &microamp_state->handle[nhandle];
-        if ( handle->endpoint )
-        {
-            uint8_t* p = (uint8_t*)buf;
-            for(int n=0; n < size; n++)
-            {
-                int t;
-                if ( (t=microamp_ring_get( handle->endpoint->head,
-                                        handle->endpoint->tail,
-                                        (void*)handle->endpoint->shmembase,
-                                        handle->endpoint->shmemsz,&p[n]
-                                        )) < 0 )
-                {
-                    b_mutex_unlock(&microamp_state->mutex);
-                    return MICROAMP_ERR_UNDFL;
-                }
-                handle->endpoint->tail = t;
-                if ( microamp_ring_avail( handle->endpoint->head, handle->endpoint->tail, handle->endpoint->shmemsz ) == 0 )
-                    handle->endpoint->dataempty = true;
-            }
-            b_mutex_unlock(&microamp_state->mutex);
-            return size;
-        }
+        microamp_iovec_t iov = { buf, size };
+        uint32_t seq = microamp_load_acquire(&endpoint->ctrl->wakeseq);
+        if ( (rc=microamp_endpoint_readv(microamp_state,endpoint,cursor,&iov,1)) != MICROAMP_ERR_UNDFL )
+            break;
+        if ( tries == 0 )
+            microamp_stat_inc(&endpoint->ctrl->underflows);
+        if ( (rc=microamp_wait(endpoint,seq,start,timeout)) < 0 )
+            break;
     }
-    b_mutex_unlock(&microamp_state->mutex);
-    return MICROAMP_ERR_NONE;
+    __atomic_fetch_sub(&endpoint->ctrl->waiters,1,__ATOMIC_ACQ_REL);
+    return rc;
 }
 
-extern int microamp_write(microamp_state_t* microamp_state,int nhandle,const void* buf,size_t size)
+extern int microamp_write_wait(microamp_state_t* microamp_state,int nhandle,const void* buf,size_t size,uint32_t timeout)
 {
-    microamp_handle_t* handle;
-    b_mutex_lock(&microamp_state->mutex);
-    if ( nhandle >= 0 && nhandle < MICROAMP_MAX_HANDLE )
+    int rc;
+    uint32_t start = microamp_systick();
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_NONE;
+    if ( endpoint->flags & MICROAMP_MODE_MPMC )
     {
-        handle = &microamp_state->handle[nhandle];
-        if ( handle->endpoint )
-        {
-            uint8_t* p = (uint8_t*)buf;
-            for(int n=0; n < size; n++)
-            {
-                int h;
-                if ( (h=microamp_ring_put( handle->endpoint->head,
-                                        handle->endpoint->tail,
-                                        (void*)handle->endpoint->shmembase,
-                                        handle->endpoint->shmemsz,p[n]
-                                        )) < 0 )
-                {
-                    b_mutex_unlock(&microamp_state->mutex);
-                    return MICROAMP_ERR_OVRFL;
-                }
-                handle->endpoint->head = h;
-                if ( microamp_ring_avail( handle->endpoint->head, handle->endpoint->tail, handle->endpoint->shmemsz ) > 0 )
-                    handle->endpoint->dataempty = false;
-            }
-            b_mutex_unlock(&microamp_state->mutex);
-            return size;
-        }
+        if ( size > endpoint->slotsz )
+            return MICROAMP_ERR_OVRFL;
     }
-    b_mutex_unlock(&microamp_state->mutex);
-    return MICROAMP_ERR_NONE;
+    else if ( size + ((endpoint->flags & MICROAMP_MODE_MSG) ? MICROAMP_MSG_HDR : 0) > microamp_ring_capacity(endpoint) )
+    {
+        return MICROAMP_ERR_OVRFL;
+    }
+
+    __atomic_fetch_add(&endpoint->ctrl->waiters,1,__ATOMIC_ACQ_REL);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);  /**< pairs with microamp_notify() */
+    for(int tries=0; ; tries++)
+    {
+        microamp_iovec_t iov = { (void*)buf, size };
+        uint32_t seq = microamp_load_acquire(&endpoint->ctrl->wakeseq);
+        if ( (rc=microamp_endpoint_writev(microamp_state,endpoint,&iov,1)) != MICROAMP_ERR_OVRFL )
+            break;
+        if ( tries == 0 )
+            microamp_stat_inc(&endpoint->ctrl->overflows);
+        if ( (rc=microamp_wait(endpoint,seq,start,timeout)) < 0 )
+            break;
+    }
+    __atomic_fetch_sub(&endpoint->ctrl->waiters,1,__ATOMIC_ACQ_REL);
+    return rc;
+}
+
+extern int microamp_readv(microamp_state_t* microamp_state,int nhandle,const microamp_iovec_t* iov,int iovcnt)
+{
+    int rc;
+    size_t* cursor;
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_NONE;
+    if ( (cursor=microamp_handle_cursor(microamp_state,nhandle,endpoint)) == NULL )
+        return MICROAMP_ERR_PROT;
+    if ( (rc=microamp_endpoint_readv(microamp_state,endpoint,cursor,iov,iovcnt)) == MICROAMP_ERR_UNDFL )
+        microamp_stat_inc(&endpoint->ctrl->underflows);
+    return rc;
+}
+
+extern int microamp_writev(microamp_state_t* microamp_state,int nhandle,const microamp_iovec_t* iov,int iovcnt)
+{
+    int rc;
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_NONE;
+    if ( (rc=microamp_endpoint_writev(microamp_state,endpoint,iov,iovcnt)) == MICROAMP_ERR_OVRFL )
+        microamp_stat_inc(&endpoint->ctrl->overflows);
+    return rc;
+}
+
+extern int microamp_write_reserve(microamp_state_t* microamp_state,int nhandle,size_t min,void** ptr,size_t* len)
+{
+    size_t head;
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_NONE;
+    if ( endpoint->flags & MICROAMP_MODE_RECORD )
+        return MICROAMP_ERR_PROT;
+    if ( ptr == NULL || len == NULL || min > microamp_ring_capacity(endpoint) )
+        return MICROAMP_ERR_INVAL;
+
+    microamp_endpoint_lock(endpoint);
+    head = endpoint->ctrl->head;
+    *ptr = (uint8_t*)endpoint->shmembase + microamp_ring_offset(endpoint,head);
+    *len = microamp_ring_contig( endpoint, head, microamp_load_acquire(&endpoint->ctrl->tail) );
+    microamp_endpoint_unlock(endpoint);
+    return *len < min ? MICROAMP_ERR_BLOCK : (int)*len;
+}
+
+extern int microamp_write_commit(microamp_state_t* microamp_state,int nhandle,size_t size)
+{
+    size_t head;
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_NONE;
+    if ( endpoint->flags & MICROAMP_MODE_RECORD )
+        return MICROAMP_ERR_PROT;
+    if ( size == 0 )
+        return 0;
+
+    microamp_endpoint_lock(endpoint);
+    head = endpoint->ctrl->head;
+    if ( microamp_ring_contig( endpoint, head, microamp_load_acquire(&endpoint->ctrl->tail) ) < size )
+    {
+        microamp_endpoint_unlock(endpoint);
+        return MICROAMP_ERR_OVRFL;
+    }
+    head = microamp_ring_advance(endpoint,head,size);
+    microamp_store_release( &endpoint->ctrl->head, head );
+    if ( endpoint->flags & MICROAMP_MODE_BCAST )
+        microamp_bcast_slowest(microamp_state,endpoint);
+    endpoint->ctrl->msgs_in++;
+    endpoint->ctrl->bytes_in += size;
+    microamp_stat_peak(endpoint,head,microamp_load_acquire(&endpoint->ctrl->tail));
+    microamp_endpoint_unlock(endpoint);
+    microamp_trace_event(MICROAMP_TRACE_WRITE,endpoint-microamp_state->endpoint,size);
+    microamp_notify(microamp_state,endpoint);
+    return size;
+}
+
+extern int microamp_peek(microamp_state_t* microamp_state,int nhandle,microamp_iovec_t seg[2])
+{
+    size_t tail, avail, first;
+    size_t* cursor;
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_NONE;
+    if ( endpoint->flags & MICROAMP_MODE_RECORD )
+        return MICROAMP_ERR_PROT;
+    if ( (cursor=microamp_handle_cursor(microamp_state,nhandle,endpoint)) == NULL )
+        return MICROAMP_ERR_PROT;
+
+    microamp_endpoint_lock(endpoint);
+    tail = microamp_ring_offset(endpoint,*cursor);
+    avail = microamp_ring_used( endpoint, microamp_load_acquire(&endpoint->ctrl->head), *cursor );
+    microamp_endpoint_unlock(endpoint);
+
+    first = endpoint->shmemsz - tail;
+    seg[0].base = (uint8_t*)endpoint->shmembase + tail;
+    seg[0].len = avail < first ? avail : first;
+    seg[1].base = (uint8_t*)endpoint->shmembase;
+    seg[1].len = avail - seg[0].len;
+    return avail;
+}
+
+extern int microamp_skip(microamp_state_t* microamp_state,int nhandle,size_t size)
+{
+    size_t tail;
+    size_t* cursor;
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_NONE;
+    if ( endpoint->flags & MICROAMP_MODE_RECORD )
+        return MICROAMP_ERR_PROT;
+    if ( (cursor=microamp_handle_cursor(microamp_state,nhandle,endpoint)) == NULL )
+        return MICROAMP_ERR_PROT;
+    if ( size == 0 )
+        return 0;
+
+    microamp_endpoint_lock(endpoint);
+    tail = *cursor;
+    if ( microamp_ring_used( endpoint, microamp_load_acquire(&endpoint->ctrl->head), tail ) < size )
+    {
+        microamp_endpoint_unlock(endpoint);
+        return MICROAMP_ERR_UNDFL;
+    }
+    microamp_store_release( cursor, microamp_ring_advance(endpoint,tail,size) );
+    if ( endpoint->flags & MICROAMP_MODE_BCAST )
+        microamp_bcast_slowest(microamp_state,endpoint);
+    endpoint->ctrl->msgs_out++;
+    endpoint->ctrl->bytes_out += size;
+    microamp_endpoint_unlock(endpoint);
+    microamp_trace_event(MICROAMP_TRACE_READ,endpoint-microamp_state->endpoint,size);
+    microamp_notify(microamp_state,endpoint);
+    return size;
 }
 
 extern int microamp_avail(microamp_state_t* microamp_state,int nhandle)
 {
-    microamp_handle_t* handle;
-    b_mutex_lock(&microamp_state->mutex);
-    if ( nhandle >= 0 && nhandle < MICROAMP_MAX_HANDLE )
+    size_t tail, avail;
+    size_t* cursor;
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_NONE;
+    if ( endpoint->flags & MICROAMP_MODE_MPMC )
+        return microamp_queue_avail(endpoint);
+    if ( (cursor=microamp_handle_cursor(microamp_state,nhandle,endpoint)) == NULL )
+        return MICROAMP_ERR_PROT;
+
+    microamp_endpoint_lock(endpoint);
+    tail = microamp_load_acquire(cursor);
+    avail = microamp_ring_used( endpoint, microamp_load_acquire(&endpoint->ctrl->head), tail );
+    if ( (endpoint->flags & MICROAMP_MODE_MSG) && avail >= MICROAMP_MSG_HDR )
     {
-        handle = &microamp_state->handle[nhandle];
-        if ( handle->endpoint )
-        {
-            size_t size = microamp_ring_avail( handle->endpoint->head,
-                                        handle->endpoint->tail,
-                                        handle->endpoint->shmemsz);
-            b_mutex_unlock(&microamp_state->mutex);
-            return size;
-        }
+        uint32_t len;
+        microamp_ring_copyout( endpoint, tail, &len, MICROAMP_MSG_HDR );
+        avail = len;
     }
-    b_mutex_unlock(&microamp_state->mutex);
-    return MICROAMP_ERR_NONE;
+    microamp_endpoint_unlock(endpoint);
+    return avail;
+}
+
+extern int microamp_space(microamp_state_t* microamp_state,int nhandle)
+{
+    size_t space;
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_NONE;
+    if ( endpoint->flags & MICROAMP_MODE_MPMC )
+    {
+        size_t tail = microamp_load_acquire(&endpoint->ctrl->tail);
+        size_t used = microamp_load_acquire(&endpoint->ctrl->head) - tail;
+        return used < endpoint->nslots ? (int)endpoint->slotsz : 0;
+    }
+
+    space = microamp_ring_free( endpoint,
+                                microamp_load_acquire(&endpoint->ctrl->head),
+                                microamp_load_acquire(&endpoint->ctrl->tail) );
+    if ( endpoint->flags & MICROAMP_MODE_MSG )
+        space = space > MICROAMP_MSG_HDR ? space - MICROAMP_MSG_HDR : 0;
+    return space;
+}
+
+extern int microamp_stats(microamp_state_t* microamp_state,int nhandle,microamp_stats_t* stats)
+{
+    microamp_endpoint_t* endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_NONE;
+    if ( stats == NULL )
+        return MICROAMP_ERR_INVAL;
+
+    microamp_endpoint_lock(endpoint);
+    stats->bytes_in = endpoint->ctrl->bytes_in;
+    stats->bytes_out = endpoint->ctrl->bytes_out;
+    stats->msgs_in = endpoint->ctrl->msgs_in;
+    stats->msgs_out = endpoint->ctrl->msgs_out;
+    stats->overflows = endpoint->ctrl->overflows;
+    stats->underflows = endpoint->ctrl->underflows;
+    stats->drops = endpoint->ctrl->drops;
+    stats->peak = endpoint->ctrl->peak;
+    stats->callbacks = endpoint->ctrl->callbacks;
+    stats->lock_contended = endpoint->ctrl->lock_contended;
+    stats->lock_wait = endpoint->ctrl->lock_wait;
+    microamp_endpoint_unlock(endpoint);
+    return 0;
 }
 
 extern int microamp_dataready_handler(microamp_state_t* microamp_state,int nhandle,void(*fn)(void*),void* arg)
 {
-    microamp_handle_t* handle;
+    return microamp_dataready_handler_ex(microamp_state,nhandle,fn,arg,1);
+}
+
+extern int microamp_dataready_handler_ex(microamp_state_t* microamp_state,int nhandle,void(*fn)(void*),void* arg,size_t rx_watermark)
+{
+    microamp_endpoint_t* endpoint;
     b_mutex_lock(&microamp_state->mutex);
-    handle = &microamp_state->handle[nhandle];
-    if ( handle->endpoint )
+    endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint != NULL )
     {
-        handle->endpoint->dataready_event.c_fn = fn;
-        handle->endpoint->dataready_event.c_arg = arg;
+        endpoint->dataready_event.c_fn = fn;
+        endpoint->dataready_event.c_arg = arg;
+        endpoint->dataready_event.c_watermark = rx_watermark;
+        microamp_pending_set(microamp_state,MICROAMP_HOOK_C,endpoint - microamp_state->endpoint);
         b_mutex_unlock(&microamp_state->mutex);
         return 0;
     }
@@ -355,13 +792,20 @@ extern int microamp_dataready_handler(microamp_state_t* microamp_state,int nhand
 
 extern int microamp_dataempty_handler(microamp_state_t* microamp_state,int nhandle,void(*fn)(void*),void* arg)
 {
-    microamp_handle_t* handle;
+    return microamp_dataempty_handler_ex(microamp_state,nhandle,fn,arg,0);
+}
+
+extern int microamp_dataempty_handler_ex(microamp_state_t* microamp_state,int nhandle,void(*fn)(void*),void* arg,size_t tx_low_watermark)
+{
+    microamp_endpoint_t* endpoint;
     b_mutex_lock(&microamp_state->mutex);
-    handle = &microamp_state->handle[nhandle];
-    if ( handle->endpoint )
+    endpoint = microamp_handle_endpoint(microamp_state,nhandle);
+    if ( endpoint != NULL )
     {
-        handle->endpoint->dataempty_event.c_fn = fn;
-        handle->endpoint->dataempty_event.c_arg = arg;
+        endpoint->dataempty_event.c_fn = fn;
+        endpoint->dataempty_event.c_arg = arg;
+        endpoint->dataempty_event.c_watermark = tx_low_watermark;
+        microamp_pending_set(microamp_state,MICROAMP_HOOK_C,endpoint - microamp_state->endpoint);
         b_mutex_unlock(&microamp_state->mutex);
         return 0;
     }
@@ -375,89 +819,787 @@ extern int microamp_dataempty_handler(microamp_state_t* microamp_state,int nhand
 ****************************************************************************/
 
 /** *************************************************************************  
- * \brief Instantiate a new endpoint and insert into the endpoint list.
+ * \brief Instantiate a new endpoint, reusing a free slot before growing 
+ *        the endpoint list.
  * \param microamp_state Pointer to starage for MicroAMP state.
  * \return pointer to new endpoint or NULL on failed
 ****************************************************************************/
 static microamp_endpoint_t* microamp_new_endpoint(microamp_state_t* microamp_state)
 {
-    if ( microamp_state->endpointcnt < MICROAMP_MAX_ENDPOINT )
+    microamp_endpoint_t* endpoint = NULL;
+    for( int index=0; index < microamp_state->endpointcnt && endpoint == NULL; index++ )
     {
-        microamp_endpoint_t* endpoint = &microamp_state->endpoint[microamp_state->endpointcnt++];
-        memset(endpoint,0,sizeof(microamp_endpoint_t));
-        return endpoint;
+        if ( microamp_state->endpoint[index].name[0] == '\0' )
+            endpoint = &microamp_state->endpoint[index];
     }
-    return NULL;
+    if ( endpoint == NULL && microamp_state->endpointcnt < MICROAMP_MAX_ENDPOINT )
+        endpoint = &microamp_state->endpoint[microamp_state->endpointcnt++];
+    if ( endpoint != NULL )
+        memset(endpoint,0,sizeof(microamp_endpoint_t));
+    return endpoint;
 }
 
 /** *************************************************************************  
- * \return an empty handle.
+ * \brief Allocate, name and index a new endpoint. Called with the state 
+ *        locked.
+ * \note An empty name marks a free slot, so it is refused, as is a name 
+ *       which would be truncated into another endpoint's.
+ * \return the endpoint index, or < 0 indicates an error condition.
 ****************************************************************************/
-static int microamp_get_empty_handle(microamp_state_t* microamp_state)
+static int microamp_create_endpoint(microamp_state_t* microamp_state,const char* name,size_t size,int flags)
+{
+    size_t shmembase;
+    microamp_endpoint_t* endpoint = NULL;
+    int index;
+
+    if ( name == NULL || name[0] == '\0' || strlen(name) > MICROAMP_MAX_NAME )
+        return MICROAMP_ERR_INVAL;
+    if ( size > microamp_shmem_size() || microamp_shmem_size() - size < sizeof(microamp_ctrl_t) )
+        return MICROAMP_ERR_RES;
+    if ( microamp_lookup(microamp_state,name) != MICROAMP_ERR_NONE )
+        return MICROAMP_ERR_DUP;
+    if ( microamp_shmem_alloc(microamp_state,sizeof(microamp_ctrl_t)+size,&shmembase) == 0 )
+        endpoint = microamp_new_endpoint(microamp_state);
+    if ( endpoint == NULL )
+        return MICROAMP_ERR_RES;
+
+    index = endpoint - microamp_state->endpoint;
+    strncpy(endpoint->name,name,MICROAMP_MAX_NAME);
+    endpoint->ctrl = (microamp_ctrl_t*)shmembase;
+    memset(endpoint->ctrl,0,sizeof(microamp_ctrl_t));
+    endpoint->shmembase = shmembase + sizeof(microamp_ctrl_t);
+    endpoint->shmemsz = size;
+    endpoint->flags = flags;
+    endpoint->dataready_event.c_watermark = 1;
+    endpoint->dataready_event.py_watermark = 1;
+    for(int hook=0; hook < MICROAMP_HOOK_MAX; hook++)
+        endpoint->ctrl->level[hook] = MICROAMP_LEVEL_BELOW;
+    microamp_name_insert(microamp_state,index);
+    return index;
+}
+
+/** *************************************************************************  
+ * \brief Return an endpoint slot, and with it its shared memory, to the 
+ *        free pool, dropping its pending events. Called with the state 
+ *        locked once nrefs is zero.
+ * \param microamp_state Pointer to starage for MicroAMP state.
+ * \param endpoint The endpoint to reclaim.
+****************************************************************************/
+static void microamp_free_endpoint(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint)
+{
+    int nendpoint = endpoint - microamp_state->endpoint;
+    for(int hook=0; hook < MICROAMP_HOOK_MAX; hook++)
+        __atomic_fetch_and(&microamp_state->pending[hook][nendpoint/32],~(1UL<<(nendpoint%32)),__ATOMIC_ACQ_REL);
+    memset(endpoint,0,sizeof(microamp_endpoint_t));
+    while ( microamp_state->endpointcnt > 0 && microamp_state->endpoint[microamp_state->endpointcnt-1].name[0] == '\0' )
+        --microamp_state->endpointcnt;
+}
+
+/** *************************************************************************  
+ * \brief First-fit allocation of @ref size bytes from the shared RAM 
+ *        region. The free space is derived from the extents of the live 
+ *        endpoints, so endpoints are sized to their workload rather than
+ *        one per page.
+ * \param microamp_state Pointer to starage for MicroAMP state.
+ * \param size The number of bytes required.
+ * \param shmembase Receives the MICROAMP_SHMEM_ALIGN aligned address.
+ * \return 0 upon success, or MICROAMP_ERR_RES when no gap is large enough.
+****************************************************************************/
+static int microamp_shmem_alloc(microamp_state_t* microamp_state,size_t size,size_t* shmembase)
 {
-    microamp_handle_t empty_handle;
-    memset(&empty_handle,0,sizeof(microamp_handle_t));
-    for(int nhandle=0; nhandle < MICROAMP_MAX_HANDLE; nhandle++)
+    size_t end = (size_t)microamp_shmem_base() + microamp_shmem_size();
+    size_t base = microamp_shmem_align((size_t)microamp_shmem_base());
+    bool moved;
+    size = microamp_shmem_align(size);
+    do
     {
-        if ( memcmp( &microamp_state->handle[nhandle], &empty_handle, sizeof(microamp_handle_t) ) == 0 )
+        moved = false;
+        for( int index=0; index < microamp_state->endpointcnt; index++ )
         {
-            return nhandle;
+            microamp_endpoint_t* endpoint = &microamp_state->endpoint[index];
+            size_t start = (size_t)endpoint->ctrl;
+            size_t used = microamp_shmem_align(sizeof(microamp_ctrl_t)+endpoint->shmemsz);
+            if ( start && start < base+size && base < start+used )
+            {
+                base = start+used;
+                moved = true;
+            }
         }
+    } while ( moved );
+    if ( base > end || end-base < size )
+        return MICROAMP_ERR_RES;
+    *shmembase = base;
+    return 0;
+}
+
+/** *************************************************************************  
+ * \return the slot of an empty handle, popped from the free list.
+****************************************************************************/
+static int microamp_get_empty_handle(microamp_state_t* microamp_state)
+{
+    int slot = microamp_state->handle_free;
+    if ( slot >= 0 )
+    {
+        microamp_state->handle_free = microamp_state->handle[slot].next;
+        microamp_state->handle[slot].next = -1;
+        return slot;
     }
     return MICROAMP_ERR_NONE;
 }
 
+/** *************************************************************************  
+ * \brief Return a handle slot to the free list, advancing its generation 
+ *        so that the closed handle value no longer resolves.
+****************************************************************************/
+static void microamp_put_empty_handle(microamp_state_t* microamp_state,int slot)
+{
+    microamp_handle_t* handle = &microamp_state->handle[slot];
+    handle->endpoint = NULL;
+    handle->gen = (handle->gen+1) & MICROAMP_HANDLE_GENS;
+    handle->next = microamp_state->handle_free;
+    microamp_state->handle_free = slot;
+}
+
+extern microamp_endpoint_t* microamp_handle_endpoint(microamp_state_t* microamp_state,int nhandle)
+{
+    if ( nhandle >= 0 && (nhandle & MICROAMP_HANDLE_MASK) < MICROAMP_MAX_HANDLE )
+    {
+        microamp_handle_t* handle = &microamp_state->handle[nhandle & MICROAMP_HANDLE_MASK];
+        if ( handle->gen == ((uint32_t)nhandle >> MICROAMP_HANDLE_BITS) )
+            return handle->endpoint;
+    }
+    return NULL;
+}
+
 /** *************************************************************************  
  * \return the index of and endpoint with @ref name, or < 0 on fail.
  * \param name the name of the endpoint to locate. 
+ * \note Names are held in an open addressed hash index, linear probing 
+ *       stops at the first never-used bucket.
 ****************************************************************************/
 static int microamp_lookup(microamp_state_t* microamp_state,const char* name)
 {
-    for( int index=0; index < microamp_state->endpointcnt; index++ )
+    uint32_t bucket = microamp_name_hash(name);
+    for( int probe=0; probe < MICROAMP_NAME_BUCKETS; probe++, bucket++ )
     {
-        microamp_endpoint_t* endpoint = &microamp_state->endpoint[index];
-        if ( strcmp(endpoint->name,name) == 0 )
+        int entry = microamp_state->name_index[bucket & (MICROAMP_NAME_BUCKETS-1)];
+        if ( entry == MICROAMP_NAME_EMPTY )
+            break;
+        if ( entry != MICROAMP_NAME_TOMB && strcmp(microamp_state->endpoint[entry-1].name,name) == 0 )
+            return entry-1;
+    }
+    return MICROAMP_ERR_NONE;
+}
+
+/** *************************************************************************  
+ * \return the FNV-1a hash of @ref name.
+****************************************************************************/
+static uint32_t microamp_name_hash(const char* name)
+{
+    uint32_t hash = 2166136261u;
+    while ( *name )
+    {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/** *************************************************************************  
+ * \brief Index the name of endpoint @ref index, into the first empty or 
+ *        vacated bucket of its probe sequence.
+****************************************************************************/
+static void microamp_name_insert(microamp_state_t* microamp_state,int index)
+{
+    uint32_t bucket = microamp_name_hash(microamp_state->endpoint[index].name);
+    for( ; ; bucket++ )
+    {
+        int16_t* entry = &microamp_state->name_index[bucket & (MICROAMP_NAME_BUCKETS-1)];
+        if ( *entry == MICROAMP_NAME_EMPTY || *entry == MICROAMP_NAME_TOMB )
         {
-            return index;
+            *entry = index+1;
+            return;
         }
     }
-    return MICROAMP_ERR_NONE;
 }
 
 /** *************************************************************************  
- * \brief Calculate the head pointer for a ring buffer 'put' operation.
+ * \brief Drop the name of endpoint @ref index from the index, leaving a 
+ *        tombstone so that later entries of the probe sequence are found.
+****************************************************************************/
+static void microamp_name_remove(microamp_state_t* microamp_state,int index)
+{
+    uint32_t bucket = microamp_name_hash(microamp_state->endpoint[index].name);
+    for( int probe=0; probe < MICROAMP_NAME_BUCKETS; probe++, bucket++ )
+    {
+        int16_t* entry = &microamp_state->name_index[bucket & (MICROAMP_NAME_BUCKETS-1)];
+        if ( *entry == MICROAMP_NAME_EMPTY )
+            return;
+        if ( *entry == index+1 )
+        {
+            *entry = MICROAMP_NAME_TOMB;
+            return;
+        }
+    }
+}
+
+/** *************************************************************************  
+ * \brief The body of microamp_readv(), for a resolved endpoint, reading 
+ *        from and advancing @ref cursor.
+****************************************************************************/
+static int microamp_endpoint_readv(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint,size_t* cursor,const microamp_iovec_t* iov,int iovcnt)
+{
+    size_t tail, avail, size = 0;
+    if ( iovcnt < 0 || (iov == NULL && iovcnt > 0) )
+        return MICROAMP_ERR_INVAL;
+    if ( endpoint->flags & MICROAMP_MODE_MPMC )
+        return microamp_queue_readv(microamp_state,endpoint,iov,iovcnt);
+    for(int n=0; n < iovcnt; n++)
+        size += iov[n].len;
+    if ( size == 0 && !(endpoint->flags & MICROAMP_MODE_MSG) )
+        return 0;  /**< moves nothing, so neither counted nor notified */
+
+    microamp_endpoint_lock(endpoint);
+    tail = *cursor;
+    avail = microamp_ring_used( endpoint, microamp_load_acquire(&endpoint->ctrl->head), tail );
+    if ( endpoint->flags & MICROAMP_MODE_MSG )
+    {
+        uint32_t len;
+        if ( avail < MICROAMP_MSG_HDR )
+        {
+            microamp_endpoint_unlock(endpoint);
+            microamp_trace_event(MICROAMP_TRACE_UNDFL,endpoint-microamp_state->endpoint,0);
+            return MICROAMP_ERR_UNDFL;
+        }
+        tail = microamp_ring_copyout( endpoint, tail, &len, MICROAMP_MSG_HDR );
+        if ( len > size )
+        {
+            microamp_endpoint_unlock(endpoint);
+            return MICROAMP_ERR_RES;
+        }
+        size = len;
+    }
+    else if ( avail < size )
+    {
+        microamp_endpoint_unlock(endpoint);
+        microamp_trace_event(MICROAMP_TRACE_UNDFL,endpoint-microamp_state->endpoint,size);
+        return MICROAMP_ERR_UNDFL;
+    }
+    avail = size;
+    for(int n=0; n < iovcnt && avail > 0; n++)
+    {
+        size_t len = iov[n].len < avail ? iov[n].len : avail;
+        tail = microamp_ring_copyout( endpoint, tail, iov[n].base, len );
+        avail -= len;
+    }
+    microamp_store_release( cursor, tail );
+    if ( endpoint->flags & MICROAMP_MODE_BCAST )
+        microamp_bcast_slowest(microamp_state,endpoint);
+    endpoint->ctrl->msgs_out++;
+    endpoint->ctrl->bytes_out += size;
+    microamp_endpoint_unlock(endpoint);
+    microamp_trace_event(MICROAMP_TRACE_READ,endpoint-microamp_state->endpoint,size);
+    microamp_notify(microamp_state,endpoint);
+    return size;
+}
+
+/** *************************************************************************  
+ * \brief The body of microamp_writev(), for a resolved endpoint.
+****************************************************************************/
+static int microamp_endpoint_writev(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint,const microamp_iovec_t* iov,int iovcnt)
+{
+    size_t head, need, size = 0;
+    if ( iovcnt < 0 || (iov == NULL && iovcnt > 0) )
+        return MICROAMP_ERR_INVAL;
+    if ( endpoint->flags & MICROAMP_MODE_MPMC )
+        return microamp_queue_writev(microamp_state,endpoint,iov,iovcnt);
+    for(int n=0; n < iovcnt; n++)
+        size += iov[n].len;
+    need = size;
+    if ( endpoint->flags & MICROAMP_MODE_MSG )
+    {
+        if ( size == 0 || size > UINT32_MAX )
+            return MICROAMP_ERR_INVAL;
+        need += MICROAMP_MSG_HDR;
+    }
+    else if ( size == 0 )
+    {
+        return 0;  /**< moves nothing, so neither counted nor notified */
+    }
+
+    microamp_endpoint_lock(endpoint);
+    head = endpoint->ctrl->head;
+    if ( (endpoint->flags & MICROAMP_MODE_DROP) && need <= microamp_ring_capacity(endpoint) )
+        microamp_bcast_drop(microamp_state,endpoint,need);
+    if ( microamp_ring_free( endpoint, head, microamp_load_acquire(&endpoint->ctrl->tail) ) < need )
+    {
+        microamp_endpoint_unlock(endpoint);
+        microamp_trace_event(MICROAMP_TRACE_OVRFL,endpoint-microamp_state->endpoint,need);
+        return MICROAMP_ERR_OVRFL;
+    }
+    if ( endpoint->flags & MICROAMP_MODE_MSG )
+    {
+        uint32_t len = size;
+        head = microamp_ring_copyin( endpoint, head, &len, MICROAMP_MSG_HDR );
+    }
+    for(int n=0; n < iovcnt; n++)
+        head = microamp_ring_copyin( endpoint, head, iov[n].base, iov[n].len );
+    microamp_store_release( &endpoint->ctrl->head, head );
+    if ( endpoint->flags & MICROAMP_MODE_BCAST )
+        microamp_bcast_slowest(microamp_state,endpoint);
+    endpoint->ctrl->msgs_in++;
+    endpoint->ctrl->bytes_in += size;
+    microamp_stat_peak(endpoint,head,microamp_load_acquire(&endpoint->ctrl->tail));
+    microamp_endpoint_unlock(endpoint);
+    microamp_trace_event(MICROAMP_TRACE_WRITE,endpoint-microamp_state->endpoint,size);
+    microamp_notify(microamp_state,endpoint);
+    return size;
+}
+
+/** *************************************************************************  
+ * \brief Enqueue one message on a MICROAMP_MODE_MPMC endpoint, a bounded 
+ *        queue in the style of D. Vyukov. A producer claims the slot at 
+ *        head when its sequence number equals head, by advancing head 
+ *        with compare and swap, fills it, and publishes it by storing 
+ *        sequence head+1. Here head and tail run free, the slot being 
+ *        their low bits.
+ * \return the number of bytes written, or < 0 on error.
+****************************************************************************/
+static int microamp_queue_writev(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint,const microamp_iovec_t* iov,int iovcnt)
+{
+    microamp_slot_t* slot;
+    uint8_t* data;
+    size_t size = 0;
+    size_t pos = __atomic_load_n(&endpoint->ctrl->head,__ATOMIC_RELAXED);
+    for(int n=0; n < iovcnt; n++)
+        size += iov[n].len;
+    if ( size == 0 || size > endpoint->slotsz )
+        return MICROAMP_ERR_INVAL;
+
+    for(;;)
+    {
+        int32_t diff;
+        slot = microamp_slot_at(endpoint,pos);
+        diff = (int32_t)(microamp_load_acquire(&slot->seq) - (uint32_t)pos);
+        if ( diff == 0 )
+        {
+            if ( __atomic_compare_exchange_n(&endpoint->ctrl->head,&pos,pos+1,true,__ATOMIC_RELAXED,__ATOMIC_RELAXED) )
+                break;
+        }
+        else if ( diff < 0 )
+        {
+            microamp_trace_event(MICROAMP_TRACE_OVRFL,endpoint-microamp_state->endpoint,size);
+            return MICROAMP_ERR_OVRFL;
+        }
+        else
+        {
+            pos = __atomic_load_n(&endpoint->ctrl->head,__ATOMIC_RELAXED);
+        }
+    }
+
+    data = (uint8_t*)(slot+1);
+    for(int n=0; n < iovcnt; n++)
+    {
+        memcpy(data,iov[n].base,iov[n].len);
+        data += iov[n].len;
+    }
+    slot->len = size;
+    microamp_store_release(&slot->seq,(uint32_t)(pos+1));
+    microamp_stat_inc(&endpoint->ctrl->msgs_in);
+    microamp_stat_add(&endpoint->ctrl->bytes_in,size);
+    microamp_trace_event(MICROAMP_TRACE_WRITE,endpoint-microamp_state->endpoint,size);
+    microamp_notify(microamp_state,endpoint);
+    return size;
+}
+
+/** *************************************************************************  
+ * \brief Dequeue one message from a MICROAMP_MODE_MPMC endpoint. A 
+ *        consumer claims the slot at tail when its sequence number equals
+ *        tail+1, empties it, and hands it back to producers by storing 
+ *        sequence tail+nslots. A message larger than @ref iov is left 
+ *        queued, and MICROAMP_ERR_RES returned.
+ * \return the number of bytes read, or < 0 on error.
+****************************************************************************/
+static int microamp_queue_readv(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint,const microamp_iovec_t* iov,int iovcnt)
+{
+    microamp_slot_t* slot;
+    const uint8_t* data;
+    size_t len, size = 0;
+    size_t pos = __atomic_load_n(&endpoint->ctrl->tail,__ATOMIC_RELAXED);
+    for(int n=0; n < iovcnt; n++)
+        size += iov[n].len;
+
+    for(;;)
+    {
+        int32_t diff;
+        slot = microamp_slot_at(endpoint,pos);
+        diff = (int32_t)(microamp_load_acquire(&slot->seq) - (uint32_t)(pos+1));
+        if ( diff == 0 )
+        {
+            if ( slot->len > size )
+                return MICROAMP_ERR_RES;
+            if ( __atomic_compare_exchange_n(&endpoint->ctrl->tail,&pos,pos+1,true,__ATOMIC_RELAXED,__ATOMIC_RELAXED) )
+                break;
+        }
+        else if ( diff < 0 )
+        {
+            microamp_trace_event(MICROAMP_TRACE_UNDFL,endpoint-microamp_state->endpoint,0);
+            return MICROAMP_ERR_UNDFL;
+        }
+        else
+        {
+            pos = __atomic_load_n(&endpoint->ctrl->tail,__ATOMIC_RELAXED);
+        }
+    }
+
+    data = (const uint8_t*)(slot+1);
+    size = len = slot->len;
+    for(int n=0; n < iovcnt && len > 0; n++)
+    {
+        size_t part = iov[n].len < len ? iov[n].len : len;
+        memcpy(iov[n].base,data,part);
+        data += part;
+        len -= part;
+    }
+    microamp_store_release(&slot->seq,(uint32_t)(pos+endpoint->nslots));
+    microamp_stat_inc(&endpoint->ctrl->msgs_out);
+    microamp_stat_add(&endpoint->ctrl->bytes_out,size);
+    microamp_trace_event(MICROAMP_TRACE_READ,endpoint-microamp_state->endpoint,size);
+    microamp_notify(microamp_state,endpoint);
+    return size;
+}
+
+/** *************************************************************************  
+ * \return the size of the next message on a MICROAMP_MODE_MPMC endpoint, 
+ *         or 0 when it is empty.
+****************************************************************************/
+static int microamp_queue_avail(microamp_endpoint_t* endpoint)
+{
+    size_t pos = microamp_load_acquire(&endpoint->ctrl->tail);
+    microamp_slot_t* slot = microamp_slot_at(endpoint,pos);
+    if ( microamp_load_acquire(&slot->seq) == (uint32_t)(pos+1) )
+        return slot->len;
+    return 0;
+}
+
+/** *************************************************************************  
+ * \return the occupancy of an endpoint which the watermarks are compared 
+ *         with, bytes, or messages on a MICROAMP_MODE_MPMC endpoint.
+****************************************************************************/
+static size_t microamp_endpoint_used(microamp_endpoint_t* endpoint)
+{
+    size_t tail = microamp_load_acquire(&endpoint->ctrl->tail);
+    size_t head = microamp_load_acquire(&endpoint->ctrl->head);
+    if ( endpoint->flags & MICROAMP_MODE_MPMC )
+        return head - tail > endpoint->nslots ? 0 : head - tail;
+    return microamp_ring_used(endpoint,head,tail);
+}
+
+/** *************************************************************************  
+ * \brief Serialize the data path of an endpoint. MICROAMP_MODE_SPSC 
+ *        endpoints take no lock, there the producer only stores head and 
+ *        the consumer only stores tail, each published with release 
+ *        semantics and observed with acquire semantics. Nor do 
+ *        MICROAMP_MODE_MPMC queues, which claim slots by compare and swap. A lock found held 
+ *        is counted, along with the time spent waiting for it.
+****************************************************************************/
+static void microamp_endpoint_lock(microamp_endpoint_t* endpoint)
+{
+    if ( endpoint->flags & MICROAMP_MODE_LOCKFREE )
+        return;
+    if ( b_mutex_try_lock(&endpoint->ctrl->mutex) )
+    {
+        uint32_t start = microamp_cycles();
+        b_mutex_lock(&endpoint->ctrl->mutex);
+        endpoint->ctrl->lock_contended++;
+        endpoint->ctrl->lock_wait += microamp_cycles()-start;
+    }
+    microamp_trace_event(MICROAMP_TRACE_LOCK,endpoint-g_microamp_state->endpoint,0);
+}
+
+static void microamp_endpoint_unlock(microamp_endpoint_t* endpoint)
+{
+    if ( endpoint->flags & MICROAMP_MODE_LOCKFREE )
+        return;
+    microamp_trace_event(MICROAMP_TRACE_UNLOCK,endpoint-g_microamp_state->endpoint,0);
+    b_mutex_unlock(&endpoint->ctrl->mutex);
+}
+
+/** *************************************************************************  
+ * \brief Flag the poll hooks which have handlers on @ref endpoint, after 
+ *        its head or tail has moved, and ring the doorbell only when a 
+ *        waiter or a poll hook may need waking, so that an unwatched 
+ *        commit costs no doorbell (a syscall with the eventfd backend).
+****************************************************************************/
+static void microamp_notify(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint)
+{
+    int nendpoint = endpoint - microamp_state->endpoint;
+    const microamp_doorbell_t* doorbell = microamp_doorbell;
+    bool ring = false;
+    /** Publish before checking for waiters, a waiter registers before 
+        checking the ring, so one side always sees the other. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if ( microamp_load_acquire(&endpoint->ctrl->waiters) )
+    {
+        __atomic_fetch_add(&endpoint->ctrl->wakeseq,1,__ATOMIC_RELEASE);
+        ring = true;
+    }
+    if ( endpoint->dataready_event.c_fn || endpoint->dataempty_event.c_fn )
+    {
+        microamp_pending_set(microamp_state,MICROAMP_HOOK_C,nendpoint);
+        ring = true;
+    }
+    if ( endpoint->dataready_event.py_fn || endpoint->dataempty_event.py_fn )
+    {
+        microamp_pending_set(microamp_state,MICROAMP_HOOK_PY,nendpoint);
+        ring = true;
+    }
+    if ( ring && doorbell != NULL && doorbell->ring != NULL )
+        doorbell->ring(doorbell->arg,nendpoint);
+}
+
+/** *************************************************************************  
+ * \return the read cursor of @ref nhandle, shared by every handle except 
+ *         on a MICROAMP_MODE_BCAST endpoint, where each subscribed handle 
+ *         has its own, or NULL if the handle has not subscribed.
+****************************************************************************/
+static size_t* microamp_handle_cursor(microamp_state_t* microamp_state,int nhandle,microamp_endpoint_t* endpoint)
+{
+    int slot = nhandle & MICROAMP_HANDLE_MASK;
+    if ( !(endpoint->flags & MICROAMP_MODE_BCAST) )
+        return &endpoint->ctrl->tail;
+    if ( endpoint->readers[slot/32] & (1u << (slot%32)) )
+        return &microamp_state->handle[slot].tail;
+    return NULL;
+}
+
+/** *************************************************************************  
+ * \brief Move the tail of a MICROAMP_MODE_BCAST endpoint to the cursor of 
+ *        its slowest reader, or to head when there are none, so that the 
+ *        free space, watermarks and events follow that reader. Called with 
+ *        the endpoint lock held.
+****************************************************************************/
+static void microamp_bcast_slowest(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint)
+{
+    size_t head = endpoint->ctrl->head;
+    size_t tail = head, most = 0;
+    for(int word=0; word < MICROAMP_HANDLE_WORDS; word++)
+    {
+        uint32_t bits = endpoint->readers[word];
+        while ( bits )
+        {
+            int slot = word*32 + __builtin_ctz(bits);
+            size_t used = microamp_ring_used(endpoint,head,microamp_state->handle[slot].tail);
+            if ( used > most )
+            {
+                most = used;
+                tail = microamp_state->handle[slot].tail;
+            }
+            bits &= bits-1;
+        }
+    }
+    microamp_store_release( &endpoint->ctrl->tail, tail );
+}
+
+/** *************************************************************************  
+ * \brief Overrun each reader of a MICROAMP_MODE_DROP endpoint which leaves 
+ *        less than @ref need bytes free, by whole records on a 
+ *        MICROAMP_MODE_MSG endpoint. Called with the endpoint lock held.
+****************************************************************************/
+static void microamp_bcast_drop(microamp_state_t* microamp_state,microamp_endpoint_t* endpoint,size_t need)
+{
+    size_t head = endpoint->ctrl->head;
+    for(int word=0; word < MICROAMP_HANDLE_WORDS; word++)
+    {
+        uint32_t bits = endpoint->readers[word];
+        while ( bits )
+        {
+            size_t* cursor = &microamp_state->handle[word*32 + __builtin_ctz(bits)].tail;
+            size_t tail = *cursor, free;
+            while ( (free=microamp_ring_free(endpoint,head,tail)) < need )
+            {
+                size_t step = need - free;
+                if ( endpoint->flags & MICROAMP_MODE_MSG )
+                {
+                    uint32_t len;
+                    microamp_ring_copyout( endpoint, tail, &len, MICROAMP_MSG_HDR );
+                    step = MICROAMP_MSG_HDR + len;
+                }
+                tail = microamp_ring_advance(endpoint,tail,step);
+                endpoint->ctrl->drops += step;
+            }
+            microamp_store_release( cursor, tail );
+            bits &= bits-1;
+        }
+    }
+    microamp_bcast_slowest(microamp_state,endpoint);
+}
+
+/** *************************************************************************  
+ * \brief Record the occupancy after a producer commit, if a new high.
+****************************************************************************/
+static void microamp_stat_peak(microamp_endpoint_t* endpoint,size_t head,size_t tail)
+{
+    uint32_t avail = microamp_ring_used(endpoint,head,tail);
+    if ( avail > endpoint->ctrl->peak )
+        endpoint->ctrl->peak = avail;
+}
+
+/** *************************************************************************  
+ * \brief Park the calling thread on the endpoint's wait queue until the 
+ *        opposite side commits (wakeseq moves on from @ref seq) or the 
+ *        timeout expires. With a doorbell the thread sleeps on it, a slice
+ *        at a time so that a ring consumed by another waiter is not lost.
+ *        Otherwise, BRISC having no blocking wait object, the parked 
+ *        thread yields its time slice rather than spinning on the ring 
+ *        under the endpoint lock.
+ * \return 0 when woken, or MICROAMP_ERR_BLOCK on timeout.
+****************************************************************************/
+static int microamp_wait(microamp_endpoint_t* endpoint,uint32_t seq,uint32_t start,uint32_t timeout)
+{
+    while ( microamp_load_acquire(&endpoint->ctrl->wakeseq) == seq )
+    {
+        const microamp_doorbell_t* doorbell = microamp_doorbell;
+        uint32_t slice = MICROAMP_DOORBELL_SLICE;
+        if ( timeout != MICROAMP_WAIT_FOREVER )
+        {
+            uint32_t elapsed = microamp_systick()-start;
+            if ( elapsed >= timeout )
+                return MICROAMP_ERR_BLOCK;
+            if ( timeout-elapsed < slice )
+                slice = timeout-elapsed;
+        }
+        if ( doorbell != NULL && doorbell->wait != NULL )
+            doorbell->wait(doorbell->arg,slice);
+        else
+            microamp_thread_yield();
+    }
+    return 0;
+}
+
+/** *************************************************************************  
+ * \brief Calculate the bytes held by a ring buffer. A MICROAMP_MODE_POW2 
+ *        ring counts with free-running indices, so it is one subtraction.
+ * \param endpoint The endpoint owning the ring.
  * \param head The current head pointer
  * \param tail The current tail pointer
- * \param buf the buffer 
- * \param size the size of the buffer. 
- * \return The updated head pointer of < 0 on overflow
+ * \return The number of bytes which may be read.
 ****************************************************************************/
-static int microamp_ring_put(size_t head, size_t tail, uint8_t* buf, size_t size, uint8_t ch)
+static size_t microamp_ring_used(const microamp_endpoint_t* endpoint, size_t head, size_t tail)
 {
-    buf[head++] = ch;
-    if ( head >= size )
-        head=0;
-    if ( head==tail )
-        return MICROAMP_ERR_OVRFL;
-    return (int)head;
+    if ( endpoint->flags & MICROAMP_MODE_POW2 )
+        return (uint32_t)(head - tail);
+    return microamp_ring_avail(head,tail,endpoint->shmemsz);
 }
 
 /** *************************************************************************  
- * \brief Calculate the tail pointer for a ring buffer 'get' operation.
+ * \brief Calculate the free space of a ring buffer.
+ * \param endpoint The endpoint owning the ring.
  * \param head The current head pointer
  * \param tail The current tail pointer
- * \param buf the buffer 
- * \param size the size of the buffer. 
- * \return The updated tail pointer of < 0 on underflow
+ * \return The number of bytes which may be written.
 ****************************************************************************/
-static int microamp_ring_get(size_t head, size_t tail, const uint8_t* buf, size_t size, uint8_t* ch)
+static size_t microamp_ring_free(const microamp_endpoint_t* endpoint, size_t head, size_t tail)
 {
-    if ( head==tail )
-        return MICROAMP_ERR_UNDFL;
-    *ch = buf[tail++];
-    if ( tail >= size )
-        tail = 0;
-    return (int)tail;
+    return microamp_ring_capacity(endpoint) - microamp_ring_used(endpoint,head,tail);
+}
+
+/** *************************************************************************  
+ * \return The most bytes a ring buffer holds. Unless MICROAMP_MODE_POW2, 
+ *         one slot is kept empty to tell a full ring from an empty one.
+****************************************************************************/
+static size_t microamp_ring_capacity(const microamp_endpoint_t* endpoint)
+{
+    if ( endpoint->shmemsz == 0 )
+        return 0;
+    return endpoint->shmemsz - ((endpoint->flags & MICROAMP_MODE_POW2) ? 0 : 1);
+}
+
+/** *************************************************************************  
+ * \return The buffer offset of ring index @ref pos.
+****************************************************************************/
+static size_t microamp_ring_offset(const microamp_endpoint_t* endpoint, size_t pos)
+{
+    if ( endpoint->flags & MICROAMP_MODE_POW2 )
+        return pos & (endpoint->shmemsz-1);
+    return pos;
+}
+
+/** *************************************************************************  
+ * \return Ring index @ref pos moved on by @ref size bytes.
+****************************************************************************/
+static size_t microamp_ring_advance(const microamp_endpoint_t* endpoint, size_t pos, size_t size)
+{
+    if ( endpoint->flags & MICROAMP_MODE_POW2 )
+        return (uint32_t)(pos + size);
+    pos += size;
+    return pos >= endpoint->shmemsz ? pos - endpoint->shmemsz : pos;
+}
+
+/** *************************************************************************  
+ * \brief Calculate the free space which is contiguous from @ref head, 
+ *        that is, up to the wrap or the last free byte before @ref tail.
+ * \return The number of contiguous bytes which may be written at head.
+****************************************************************************/
+static size_t microamp_ring_contig(const microamp_endpoint_t* endpoint, size_t head, size_t tail)
+{
+    size_t free = microamp_ring_free(endpoint,head,tail);
+    size_t first = endpoint->shmemsz - microamp_ring_offset(endpoint,head);
+    return free < first ? free : first;
+}
+
+/** *************************************************************************  
+ * \brief Copy into the ring at @ref head in at most two contiguous 
+ *        segments, before and after the wrap. The caller has already 
+ *        checked that @ref size bytes are free.
+ * \param endpoint The endpoint owning the ring.
+ * \param head The current head pointer
+ * \param buf the source buffer 
+ * \param size the number of bytes to copy. 
+ * \return The updated head pointer.
+****************************************************************************/
+static size_t microamp_ring_copyin(microamp_endpoint_t* endpoint, size_t head, const void* buf, size_t size)
+{
+    uint8_t* ring = (uint8_t*)endpoint->shmembase;
+    size_t offset = microamp_ring_offset(endpoint,head);
+    size_t first = endpoint->shmemsz - offset;
+    if ( size < first )
+    {
+        memcpy(&ring[offset],buf,size);
+    }
+    else
+    {
+        memcpy(&ring[offset],buf,first);
+        memcpy(ring,(const uint8_t*)buf+first,size-first);
+    }
+    return microamp_ring_advance(endpoint,head,size);
+}
+
+/** *************************************************************************  
+ * \brief Copy out of the ring at @ref tail in at most two contiguous 
+ *        segments, before and after the wrap. The caller has already 
+ *        checked that @ref size bytes are available.
+ * \param endpoint The endpoint owning the ring.
+ * \param tail The current tail pointer
+ * \param buf the destination buffer 
+ * \param size the number of bytes to copy. 
+ * \return The updated tail pointer.
+****************************************************************************/
+static size_t microamp_ring_copyout(const microamp_endpoint_t* endpoint, size_t tail, void* buf, size_t size)
+{
+    const uint8_t* ring = (const uint8_t*)endpoint->shmembase;
+    size_t offset = microamp_ring_offset(endpoint,tail);
+    size_t first = endpoint->shmemsz - offset;
+    if ( size < first )
+    {
+        memcpy(buf,&ring[offset],size);
+    }
+    else
+    {
+        memcpy(buf,&ring[offset],first);
+        memcpy((uint8_t*)buf+first,ring,size-first);
+    }
+    return microamp_ring_advance(endpoint,tail,size);
 }
 
 extern int microamp_ring_avail(size_t head, size_t tail, size_t size)
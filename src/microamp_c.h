@@ -48,6 +48,32 @@ extern "C"
                                 /**< maximum number of endpoint handles */
 #endif
 
+#if !defined(MICROAMP_HANDLE_BITS)
+#define MICROAMP_HANDLE_BITS 8    /**< low handle bits holding the slot, the rest a generation */
+#endif
+#define MICROAMP_HANDLE_MASK ((1<<MICROAMP_HANDLE_BITS)-1)
+#define MICROAMP_HANDLE_GENS (0x3FFFFFFF>>MICROAMP_HANDLE_BITS)
+                                /**< generation mask, keeping handles positive and 
+                                     within a MicroPython small int */
+
+#if !defined(MICROAMP_NAME_BUCKETS)
+#define MICROAMP_NAME_BUCKETS 32  /**< name index size, a power of 2 > MICROAMP_MAX_ENDPOINT */
+#endif
+
+#if !defined(MICROAMP_CACHE_LINE)
+#define MICROAMP_CACHE_LINE 32    /**< Data cache line size, padding the endpoint control blocks */
+#endif
+
+#if !defined(MICROAMP_SHMEM_ALIGN)
+#define MICROAMP_SHMEM_ALIGN MICROAMP_CACHE_LINE
+                                /**< Shared RAM allocation granule (power of 2) */
+#endif
+
+#define MICROAMP_PENDING_WORDS ((MICROAMP_MAX_ENDPOINT+31)/32)
+                                /**< 32 bit words in a pending-event bitmap */
+#define MICROAMP_HANDLE_WORDS ((MICROAMP_MAX_HANDLE+31)/32)
+                                /**< 32 bit words in a handle bitmap */
+
 #if !defined(MICROAMP_MAX_NAME)
 #define MICROAMP_MAX_NAME   10  /**< Maximum endpoint-name string length */
 #endif
@@ -61,18 +87,163 @@ extern "C"
 #define MICROAMP_ERR_UNDFL  -7  /**< Underflow */
 #define MICROAMP_ERR_INVAL  -8  /**< Invalid Input */
 
+#define MICROAMP_HOOK_C      0    /**< microamp_poll_hook() pending events */
+#define MICROAMP_HOOK_PY     1    /**< py_microamp_poll_hook() pending events */
+#define MICROAMP_HOOK_MAX    2
+
+#define MICROAMP_WAIT_FOREVER 0xFFFFFFFF /**< microamp_xxx_wait() without timeout */
+
+#define MICROAMP_EVENT_READY 0x01 /**< avail rose to the dataready watermark */
+#define MICROAMP_EVENT_EMPTY 0x02 /**< avail fell to the dataempty watermark */
+
+#define MICROAMP_MODE_STREAM 0x00 /**< Mutex protected byte stream (default) */
+#define MICROAMP_MODE_SPSC   0x01 /**< Lock-free single-producer/single-consumer */
+#define MICROAMP_MODE_MSG    0x02 /**< Length-prefixed records (datagrams) */
+#define MICROAMP_MODE_MPMC   0x04 /**< Lock-free fixed-slot queue, see microamp_create_queue() */
+#define MICROAMP_MODE_BCAST  0x08 /**< One read cursor per subscribed handle, see microamp_subscribe() */
+#define MICROAMP_MODE_DROP   0x10 /**< With MICROAMP_MODE_BCAST, overrun the slowest reader rather than refuse */
+#define MICROAMP_MODE_POW2   0x20 /**< Power of 2 ring, free-running indices, no slot kept empty */
+
+#define MICROAMP_TRACE_WRITE      0x01  /**< bytes published by a writer */
+#define MICROAMP_TRACE_READ       0x02  /**< bytes consumed by a reader */
+#define MICROAMP_TRACE_OVRFL      0x03  /**< write refused */
+#define MICROAMP_TRACE_UNDFL      0x04  /**< read refused */
+#define MICROAMP_TRACE_LOCK       0x05  /**< data path lock acquired */
+#define MICROAMP_TRACE_UNLOCK     0x06  /**< data path lock released */
+#define MICROAMP_TRACE_POLL       0x07  /**< microamp_poll_hook() dispatch, bytes is the events */
+#define MICROAMP_TRACE_CB_ENTER   0x08  /**< C callback entry, bytes is the event */
+#define MICROAMP_TRACE_CB_EXIT    0x09  /**< C callback exit */
+#define MICROAMP_TRACE_PY_POLL    0x0A  /**< py_microamp_poll_hook() dispatch */
+#define MICROAMP_TRACE_PY_ENTER   0x0B  /**< Python callback entry */
+#define MICROAMP_TRACE_PY_EXIT    0x0C  /**< Python callback exit */
+
+#define MICROAMP_TRACE_MAGIC      0x43525441  /**< "ATRC" */
+
+#if !defined(MICROAMP_TRACE_SIZE)
+#define MICROAMP_TRACE_SIZE       256   /**< trace records per core (power of 2) */
+#endif
+
+#if !defined(MICROAMP_TRACE_CORE)
+#define MICROAMP_TRACE_CORE       0     /**< which core's trace ring this build fills */
+#endif
+
+/** *************************************************************************  
+ * \brief One trace event. @ref seq is written last, it is 0 while the 
+ *        record is being filled and otherwise its position in the stream.
+****************************************************************************/
+typedef struct _microamp_trace_rec_
+{
+    uint32_t                seq;
+    uint32_t                time;
+    uint16_t                event;
+    uint16_t                endpoint;
+    uint32_t                bytes;
+} microamp_trace_rec_t;
+
 /** *************************************************************************  
- * \brief maintains the state of an endpoint callback.
+ * \brief A core's trace ring, the most recent MICROAMP_TRACE_SIZE events. 
+ *        Dump it as a binary image, such as with gdb 
+ *        "dump binary value core0.trace microamp_trace", and decode with
+ *        host/microamp_trace_dump.
+****************************************************************************/
+typedef struct _microamp_trace_
+{
+    uint32_t                magic;
+    uint16_t                core;
+    uint16_t                size;
+    uint32_t                head;
+    uint32_t                reserved;
+    microamp_trace_rec_t    rec[MICROAMP_TRACE_SIZE];
+} microamp_trace_t;
+
+/** *************************************************************************  
+ * \brief maintains the state of an endpoint callback. The C and Python 
+ *        registrations each keep their own watermark.
 ****************************************************************************/
 typedef struct _microamp_callback_
 {
     void* /* mp_obj_t */        py_fn;
     void* /* mp_obj_t */        py_arg;
+    size_t                      py_watermark;
     void                        (*py_microamppoll_hook_fn)(void);
     void                        (*c_fn)(void*);
     void*                       c_arg;
+    size_t                      c_watermark;
 } microamp_callback_t;
 
+/** *************************************************************************  
+ * \brief describes one contiguous segment of memory.
+****************************************************************************/
+typedef struct _microamp_iovec_
+{
+    void*                   base;
+    size_t                  len;
+} microamp_iovec_t;
+
+/** *************************************************************************  
+ * \brief A cross-core doorbell, rung when a head or tail is committed on an
+ *        endpoint with a microamp_read_wait()/microamp_write_wait() caller
+ *        blocked on it or a data handler installed, and not otherwise.
+ *        On hardware @ref ring raises an IPI or mailbox interrupt on the 
+ *        other core, and @ref wait sleeps until the other core rings.
+****************************************************************************/
+typedef struct _microamp_doorbell_
+{
+    void                    (*ring)(void* arg,int nendpoint);
+    int                     (*wait)(void* arg,uint32_t timeout);
+    void*                   arg;
+} microamp_doorbell_t;
+
+/** *************************************************************************  
+ * \brief per-endpoint counters, kept on the hot path so that a saturating
+ *        or dropping channel can be found without a debugger.
+****************************************************************************/
+typedef struct _microamp_stats_
+{
+    uint64_t                bytes_in;       /**< bytes committed by writers */
+    uint64_t                bytes_out;      /**< bytes consumed by readers */
+    uint32_t                msgs_in;        /**< successful writes */
+    uint32_t                msgs_out;       /**< successful reads */
+    uint32_t                overflows;      /**< writes refused, MICROAMP_ERR_OVRFL */
+    uint32_t                underflows;     /**< reads refused, MICROAMP_ERR_UNDFL */
+    uint32_t                drops;          /**< bytes overrun under MICROAMP_MODE_DROP */
+    uint32_t                peak;           /**< highest occupancy in bytes */
+    uint32_t                callbacks;      /**< dataready/dataempty callbacks run */
+    uint32_t                lock_contended; /**< data path lock found held */
+    uint32_t                lock_wait;      /**< microamp_cycles() spent waiting for it */
+} microamp_stats_t;
+
+/** *************************************************************************  
+ * \brief The part of an endpoint which both cores write, resident in 
+ *        shared RAM ahead of the ring. The producer index, the consumer 
+ *        index and the lock each have a cache line of their own, shared 
+ *        with the counters that side updates, so neither side's updates 
+ *        evict the other's. See microamp_stats_t for the counters.
+****************************************************************************/
+typedef struct _microamp_ctrl_
+{
+    size_t                  head __attribute__((aligned(MICROAMP_CACHE_LINE)));
+    uint64_t                bytes_in;
+    uint32_t                msgs_in;
+    uint32_t                overflows;
+    uint32_t                peak;
+    uint32_t                drops;
+
+    size_t                  tail __attribute__((aligned(MICROAMP_CACHE_LINE)));
+    uint64_t                bytes_out;
+    uint32_t                msgs_out;
+    uint32_t                underflows;
+
+    brisc_mutex_t           mutex __attribute__((aligned(MICROAMP_CACHE_LINE)));
+    brisc_mutex_t           user_mutex;
+    uint32_t                waiters;
+    uint32_t                wakeseq;
+    uint32_t                lock_contended;
+    uint32_t                lock_wait;
+    uint32_t                callbacks;
+    uint8_t                 level[MICROAMP_HOOK_MAX];
+} microamp_ctrl_t;
+
 /** *************************************************************************  
  * \brief maintains the state of an endpoint.
 ****************************************************************************/
@@ -81,13 +252,15 @@ typedef struct _microamp_endpoint_
     char                    name[MICROAMP_MAX_NAME+1];
     size_t                  shmembase;
     size_t                  shmemsz;
-    brisc_mutex_t           mutex;
+    size_t                  slotsz;
+    size_t                  nslots;
+    int                     flags;
+    microamp_ctrl_t*        ctrl;
     size_t                  nrefs;
-    size_t                  head;
-    size_t                  tail;
+    bool                    destroyed;
+    uint32_t                readers[MICROAMP_HANDLE_WORDS];
     microamp_callback_t     dataready_event;
     microamp_callback_t     dataempty_event;
-    bool                    dataempty;
 } microamp_endpoint_t;
 
 /** *************************************************************************  
@@ -96,6 +269,9 @@ typedef struct _microamp_endpoint_
 typedef struct _microamp_handle_
 {
     microamp_endpoint_t*    endpoint;
+    uint32_t                gen;
+    int                     next;
+    size_t                  tail;
 } microamp_handle_t;
 
 /** *************************************************************************  
@@ -107,6 +283,9 @@ typedef struct _microamp_state_
     size_t                  endpointcnt;
     brisc_mutex_t           mutex;
     microamp_handle_t       handle[MICROAMP_MAX_HANDLE];
+    int                     handle_free;
+    int16_t                 name_index[MICROAMP_NAME_BUCKETS];
+    uint32_t                pending[MICROAMP_HOOK_MAX][MICROAMP_PENDING_WORDS];
 } microamp_state_t;
 
 
@@ -126,33 +305,181 @@ typedef struct _microamp_state_
 extern int microamp_ring_avail(size_t head, size_t tail, size_t size);
 
 
+/** *************************************************************************  
+******************************* Hot-Path Trace ****************************** 
+****************************************************************************/
+
+#if defined(MICROAMP_TRACE)
+
+/** *************************************************************************  
+ * \brief This core's trace ring.
+****************************************************************************/
+extern microamp_trace_t microamp_trace;
+
+/** *************************************************************************  
+ * \brief Append an event to this core's trace ring, lock-free and safe 
+ *        from any thread or interrupt.
+ * \param event MICROAMP_TRACE_xxx.
+ * \param nendpoint The endpoint index.
+ * \param bytes The byte count, or the event specific value.
+****************************************************************************/
+extern void microamp_trace_record(int event,int nendpoint,size_t bytes);
+
+#define microamp_trace_event(event,nendpoint,bytes) microamp_trace_record((event),(nendpoint),(bytes))
+
+#else
+
+#define microamp_trace_event(event,nendpoint,bytes)
+
+#endif
+
+
 /** *************************************************************************  
 *************************** Poll For I/O Events ***************************** 
 ****************************************************************************/
 
 /** *************************************************************************  
  * \brief Called frequently in event loop to dispatch events
+ * \note The pending bits and the edge levels each hook keeps per endpoint
+ *       live in the shared microamp_state_t, as do the handlers, so there 
+ *       is one C handler and one Python handler per endpoint system wide. 
+ *       Run microamp_poll_hook() on one core (or host process) only, the 
+ *       one which installed the C handlers, and py_microamp_poll_hook() on 
+ *       the core running MicroPython; a second poller of the same hook 
+ *       would take pending bits and clear edges the first one needs, and 
+ *       call function pointers which are not valid in its address space.
 ****************************************************************************/
 extern void microamp_poll_hook(void);
 
+/** *************************************************************************  
+ * \brief Atomically fetch and clear one word of a pending-event bitmap.
+ * \param microamp_state A pointer to the microamp state.
+ * \param hook MICROAMP_HOOK_C or MICROAMP_HOOK_PY.
+ * \param word The bitmap word, 0 to MICROAMP_PENDING_WORDS-1.
+ * \return The bits, bit n represents endpoint (word*32)+n.
+****************************************************************************/
+extern uint32_t microamp_pending_take(microamp_state_t* microamp_state,int hook,int word);
+
+/** *************************************************************************  
+ * \brief Mark an endpoint as having pending events for a poll hook.
+ * \param microamp_state A pointer to the microamp state.
+ * \param hook MICROAMP_HOOK_C or MICROAMP_HOOK_PY.
+ * \param nendpoint The endpoint index.
+****************************************************************************/
+extern void microamp_pending_set(microamp_state_t* microamp_state,int hook,int nendpoint);
+
+/** *************************************************************************  
+ * \brief Compare the occupancy of an endpoint with the watermarks that hook
+ *        registered against what it last saw, for edge triggered dispatch.
+ * \param microamp_state A pointer to the microamp state.
+ * \param hook MICROAMP_HOOK_C or MICROAMP_HOOK_PY.
+ * \param nendpoint The endpoint index.
+ * \return MICROAMP_EVENT_xxx bits for the thresholds crossed since last call.
+****************************************************************************/
+extern int microamp_poll_events(microamp_state_t* microamp_state,int hook,int nendpoint);
+
+/** *************************************************************************  
+ * \brief Install the doorbell used by this core, or NULL for none. 
+ * \param doorbell Pointer to the doorbell, which must remain valid.
+****************************************************************************/
+extern void microamp_set_doorbell(const microamp_doorbell_t* doorbell);
+
+/** *************************************************************************  
+ * \brief Sleep until the doorbell is rung, instead of polling head/tail.
+ *        Only commits which someone is waiting on or has a handler for 
+ *        ring it, see microamp_doorbell_t.
+ * \param timeout Systicks to wait, or MICROAMP_WAIT_FOREVER.
+ * \return 0 when rung, MICROAMP_ERR_BLOCK on timeout, or 
+ *         MICROAMP_ERR_NONE when there is no doorbell with a wait.
+****************************************************************************/
+extern int microamp_doorbell_wait(uint32_t timeout);
+
 /** *************************************************************************  
  * \brief Initialize MicroAMP state
  * \param microamp_state Pointer to starage for MicroAMP state.
 ****************************************************************************/
 extern void microamp_init(microamp_state_t* microamp_state);
 
+/** *************************************************************************  
+ * \brief Adopt MicroAMP state already initialized by another process or 
+ *        core, without clearing it.
+ * \param microamp_state Pointer to the initialized MicroAMP state.
+****************************************************************************/
+extern void microamp_attach(microamp_state_t* microamp_state);
+
 /** *************************************************************************   
  * \brief Create a new endpoint using @name, and a shared buffer 
  *        of @ref size bytes.
  * \param microamp_state A pointer to the microamp state.
- * \param name The ascii name of the endpoint.
- * \param size The size of the shared memory buffer to allocate
+ * \param name The ascii name of the endpoint, 1 to MICROAMP_MAX_NAME 
+ *        characters, or MICROAMP_ERR_INVAL.
+ * \param size The size of the shared memory buffer to allocate, from 
+ *        anywhere in the shared RAM region in MICROAMP_SHMEM_ALIGN units, 
+ *        after the endpoint's microamp_ctrl_t.
  * \return 0 upon success, or < 0 indicates an error condition.
 ****************************************************************************/
 extern int microamp_create(microamp_state_t* microamp_state,
                             const char* name,
                             size_t size);
 
+/** *************************************************************************   
+ * \brief Create a new endpoint using @name, and a shared buffer 
+ *        of @ref size bytes, operating in the mode given by @ref flags.
+ * \param microamp_state A pointer to the microamp state.
+ * \param name The ascii name of the endpoint.
+ * \param size The size of the shared memory buffer to allocate
+ * \param flags MICROAMP_MODE_xxx bits.
+ * \note In MICROAMP_MODE_SPSC the producer only ever writes head and the
+ *       consumer only ever writes tail, so microamp_read() and microamp_write()
+ *       take no mutex. The caller guarantees exactly one reader and one writer.
+ * \note In MICROAMP_MODE_MSG each microamp_write() enqueues one whole record 
+ *       or nothing, each microamp_read() returns exactly one record, and 
+ *       microamp_avail() returns the size of the next record.
+ * \note In MICROAMP_MODE_BCAST every subscribed handle reads the whole 
+ *       stream through its own cursor, and the writer is held back by the 
+ *       slowest of them, or with MICROAMP_MODE_DROP overruns it. 
+ *       microamp_space(), the watermarks and the events follow the slowest 
+ *       reader. Not with MICROAMP_MODE_SPSC.
+ * \note In MICROAMP_MODE_POW2 @ref size must be a power of 2. head and 
+ *       tail then count bytes modulo 2^32 and are masked to index the 
+ *       buffer, so occupancy is head - tail and all @ref size bytes hold 
+ *       data, rather than all but one.
+ * \return 0 upon success, or < 0 indicates an error condition.
+****************************************************************************/
+extern int microamp_create_ex(microamp_state_t* microamp_state,
+                            const char* name,
+                            size_t size,
+                            int flags);
+
+/** *************************************************************************   
+ * \brief Create a new multi-producer/multi-consumer queue endpoint using 
+ *        @name, of @ref nslots messages of up to @ref slotsz bytes.
+ * \param microamp_state A pointer to the microamp state.
+ * \param name The ascii name of the endpoint.
+ * \param slotsz The largest message in bytes.
+ * \param nslots The number of slots, a power of 2.
+ * \note Each slot carries a sequence number, so any number of readers and 
+ *       writers on either core enqueue and dequeue without a lock. Each 
+ *       microamp_write() enqueues one message, each microamp_read() 
+ *       dequeues one, and microamp_avail() returns the size of the next. 
+ *       Watermarks count messages rather than bytes.
+ * \return 0 upon success, or < 0 indicates an error condition.
+****************************************************************************/
+extern int microamp_create_queue(microamp_state_t* microamp_state,
+                            const char* name,
+                            size_t slotsz,
+                            size_t nslots);
+
+/** *************************************************************************   
+ * \brief Start a read cursor for \ref nhandle on a MICROAMP_MODE_BCAST 
+ *        endpoint, at the current head. Reads from the handle then see 
+ *        every later write, until microamp_close().
+ * \param microamp_state A pointer to the microamp state.
+ * \param nhandle The handle of the endpoint.
+ * \return 0 upon success, or < 0 indicates an error condition.
+****************************************************************************/
+extern int microamp_subscribe(microamp_state_t* microamp_state,int nhandle);
+
 /** *************************************************************************   
  * \brief Test if an endpoint exists by @name
  * \param microamp_state A pointer to the microamp state.
@@ -163,7 +490,9 @@ extern int microamp_indexof(microamp_state_t* microamp_state,
                             const char* name);
 
 /** *************************************************************************   
- * \return Number of endpoints, or < 0 indicates and error condition.
+ * \return Number of endpoint slots, or < 0 indicates and error condition.
+ * \note Slots freed by microamp_destroy() may leave holes, for which 
+ *       microamp_at() returns NULL.
 ****************************************************************************/
 extern int microamp_count(microamp_state_t* microamp_state);
 
@@ -173,6 +502,16 @@ extern int microamp_count(microamp_state_t* microamp_state);
 ****************************************************************************/
 extern const char* microamp_at(microamp_state_t* microamp_state,int index);
 
+/** *************************************************************************   
+ * \brief Destroy an endpoint by @name. The name is released at once, the
+ *        slot and shared memory are reclaimed once the last handle is 
+ *        closed.
+ * \param microamp_state A pointer to the microamp state.
+ * \param name The ascii name of the endpoint.
+ * \return 0 upon success, or < 0 indicates and error condition.
+****************************************************************************/
+extern int microamp_destroy(microamp_state_t* microamp_state,const char* name);
+
 /** *************************************************************************   
  * \brief Open an endpoint by @name
  * \param microamp_state A pointer to the microamp state.
@@ -181,6 +520,15 @@ extern const char* microamp_at(microamp_state_t* microamp_state,int index);
 ****************************************************************************/
 extern int microamp_open(microamp_state_t* microamp_state,const char* name);
 
+/** *************************************************************************   
+ * \brief Resolve a handle to its endpoint in constant time.
+ * \param microamp_state A pointer to the microamp state.
+ * \param nhandle The handle of the endpoint.
+ * \return the endpoint, or NULL when \ref nhandle is out of range or stale,
+ *         that is, it has been closed since it was returned by microamp_open().
+****************************************************************************/
+extern microamp_endpoint_t* microamp_handle_endpoint(microamp_state_t* microamp_state,int nhandle);
+
 /** *************************************************************************   
  * \brief Close an endpoint
  * \param microamp_state A pointer to the microamp state.
@@ -193,6 +541,9 @@ extern int microamp_close(microamp_state_t* microamp_state,int nhandle);
  * \brief Blocking, lock the buffer semaphore.
  * \param microamp_state A pointer to the microamp state.
  * \param nhandle The handle of the endpoint.
+ * \note This is the application's lock, apart from the one which 
+ *       serializes microamp_read(), microamp_write() and microamp_avail(), 
+ *       so those may be called while holding it.
  * \return 0 upon success, or < 0 indicates and error condition.
 ****************************************************************************/
 extern int microamp_lock(microamp_state_t* microamp_state,int nhandle);
@@ -219,7 +570,9 @@ extern int microamp_trylock(microamp_state_t* microamp_state,int nhandle);
  * \param nhandle The handle of the endpoint.
  * \param buffer A pointer to the read storage buffer area.
  * \param size The maximum size to read.
- * \return the number of bytes read, or < 0 on error.
+ * \return the number of bytes read, or < 0 on error. On a MICROAMP_MODE_MSG
+ *         endpoint MICROAMP_ERR_RES is returned, and the record left in 
+ *         place, when it does not fit in \ref size.
 ****************************************************************************/
 extern int microamp_read(microamp_state_t* microamp_state,int nhandle,void* buf,size_t size);
 
@@ -233,6 +586,103 @@ extern int microamp_read(microamp_state_t* microamp_state,int nhandle,void* buf,
 ****************************************************************************/
 extern int microamp_write(microamp_state_t* microamp_state,int nhandle,const void* buf,size_t size);
 
+/** *************************************************************************   
+ * \brief Read bytes from the endpoint associated with \ref nhandle, 
+ *        parking the calling thread until they are available.
+ * \param microamp_state A pointer to the microamp state.
+ * \param nhandle The handle of the endpoint.
+ * \param buffer A pointer to the read storage buffer area.
+ * \param size The size to read.
+ * \param timeout Systicks to wait, or MICROAMP_WAIT_FOREVER.
+ * \return the number of bytes read, MICROAMP_ERR_BLOCK on timeout, 
+ *         MICROAMP_ERR_UNDFL at once if the ring can never hold \ref size 
+ *         bytes, or < 0 on error.
+****************************************************************************/
+extern int microamp_read_wait(microamp_state_t* microamp_state,int nhandle,void* buf,size_t size,uint32_t timeout);
+
+/** *************************************************************************   
+ * \brief Write bytes to the endpoint associated with \ref nhandle, 
+ *        parking the calling thread until there is room for them.
+ * \param microamp_state A pointer to the microamp state.
+ * \param nhandle The handle of the endpoint.
+ * \param buffer A pointer to the write storage buffer area.
+ * \param size The size to write.
+ * \param timeout Systicks to wait, or MICROAMP_WAIT_FOREVER.
+ * \return the number of bytes written, MICROAMP_ERR_BLOCK on timeout, 
+ *         or < 0 on error.
+****************************************************************************/
+extern int microamp_write_wait(microamp_state_t* microamp_state,int nhandle,const void* buf,size_t size,uint32_t timeout);
+
+/** *************************************************************************   
+ * \brief Scatter read from the endpoint associated with \ref nhandle,
+ *        filling \ref iov in order under one lock and one tail update.
+ * \param microamp_state A pointer to the microamp state.
+ * \param nhandle The handle of the endpoint.
+ * \param iov The array of destination segments.
+ * \param iovcnt The number of elements in \ref iov.
+ * \return the number of bytes read, or < 0 on error, as microamp_read().
+****************************************************************************/
+extern int microamp_readv(microamp_state_t* microamp_state,int nhandle,const microamp_iovec_t* iov,int iovcnt);
+
+/** *************************************************************************   
+ * \brief Gather write to the endpoint associated with \ref nhandle. All of
+ *        \ref iov is enqueued under one lock and published with one head
+ *        update, or nothing is. On a MICROAMP_MODE_MSG endpoint \ref iov 
+ *        forms a single record.
+ * \param microamp_state A pointer to the microamp state.
+ * \param nhandle The handle of the endpoint.
+ * \param iov The array of source segments.
+ * \param iovcnt The number of elements in \ref iov.
+ * \return the number of bytes written, or < 0 on error.
+****************************************************************************/
+extern int microamp_writev(microamp_state_t* microamp_state,int nhandle,const microamp_iovec_t* iov,int iovcnt);
+
+/** *************************************************************************   
+ * \brief Reserve a contiguous region of the endpoint's shared memory ring
+ *        which the caller may fill in place, for instance by DMA.
+ * \param microamp_state A pointer to the microamp state.
+ * \param nhandle The handle of the endpoint.
+ * \param min The minimum number of contiguous bytes required.
+ * \param ptr Receives a pointer to the reserved region.
+ * \param len Receives the number of contiguous bytes at \ref ptr.
+ * \note The region is not visible to the reader until microamp_write_commit().
+ *       Only one producer may hold a reservation on an endpoint at a time.
+ * \return the number of bytes reserved, or MICROAMP_ERR_BLOCK when fewer
+ *        than \ref min contiguous bytes are free (\ref len still receives
+ *        the contiguous space), or < 0 on error.
+****************************************************************************/
+extern int microamp_write_reserve(microamp_state_t* microamp_state,int nhandle,size_t min,void** ptr,size_t* len);
+
+/** *************************************************************************   
+ * \brief Publish bytes filled in after microamp_write_reserve().
+ * \param microamp_state A pointer to the microamp state.
+ * \param nhandle The handle of the endpoint.
+ * \param size The number of bytes to publish, no more than were reserved.
+ * \return the number of bytes committed, or < 0 on error.
+****************************************************************************/
+extern int microamp_write_commit(microamp_state_t* microamp_state,int nhandle,size_t size);
+
+/** *************************************************************************   
+ * \brief Expose the readable bytes of the endpoint's ring without 
+ *        consuming them.
+ * \param microamp_state A pointer to the microamp state.
+ * \param nhandle The handle of the endpoint.
+ * \param seg Receives up to two segments, before and after the wrap, 
+ *        seg[1].len is 0 when the data does not wrap.
+ * \note The segments remain valid until microamp_skip() passes them.
+ * \return the total number of bytes in \ref seg, or < 0 on error.
+****************************************************************************/
+extern int microamp_peek(microamp_state_t* microamp_state,int nhandle,microamp_iovec_t seg[2]);
+
+/** *************************************************************************   
+ * \brief Consume bytes from the endpoint without copying them.
+ * \param microamp_state A pointer to the microamp state.
+ * \param nhandle The handle of the endpoint.
+ * \param size The number of bytes to advance tail by.
+ * \return the number of bytes skipped, or < 0 on error.
+****************************************************************************/
+extern int microamp_skip(microamp_state_t* microamp_state,int nhandle,size_t size);
+
 /** *************************************************************************   
  * \brief Number of bytes available bytes to the endpoint associated 
  *        with \ref nhandle.
@@ -242,6 +692,27 @@ extern int microamp_write(microamp_state_t* microamp_state,int nhandle,const voi
 ****************************************************************************/
 extern int microamp_avail(microamp_state_t* microamp_state,int nhandle);
 
+/** *************************************************************************   
+ * \brief Number of bytes which may be written to the endpoint associated 
+ *        with \ref nhandle without overflow.
+ * \param microamp_state A pointer to the microamp state.
+ * \param nhandle The handle of the endpoint.
+ * \return the number of bytes free (the largest record on a 
+ *         MICROAMP_MODE_MSG endpoint), or < 0 on error.
+****************************************************************************/
+extern int microamp_space(microamp_state_t* microamp_state,int nhandle);
+
+/** *************************************************************************   
+ * \brief Snapshot the counters of the endpoint associated with \ref nhandle.
+ * \param microamp_state A pointer to the microamp state.
+ * \param nhandle The handle of the endpoint.
+ * \param stats Receives the counters.
+ * \note The counters are shared by every handle on the endpoint. Blocking 
+ *       microamp_xxx_wait() calls count one overflow or underflow per call.
+ * \return 0 or < 0 on error.
+****************************************************************************/
+extern int microamp_stats(microamp_state_t* microamp_state,int nhandle,microamp_stats_t* stats);
+
 /** *************************************************************************   
  * \brief Add a dataready event callback
  * \param microamp_state A pointer to the microamp state.
@@ -251,6 +722,18 @@ extern int microamp_avail(microamp_state_t* microamp_state,int nhandle);
 ****************************************************************************/
 extern int microamp_dataready_handler(microamp_state_t* microamp_state,int nhandle,void(*fn)(void*),void* arg);
 
+/** *************************************************************************   
+ * \brief Add a dataready event callback, edge triggered when the bytes
+ *        available rise to \ref rx_watermark. The watermark applies to 
+ *        this C registration only.
+ * \param microamp_state A pointer to the microamp state.
+ * \param callback A function pointer.
+ * \param arg The arg to pass to the callback.
+ * \param rx_watermark The threshold in bytes, 0 is treated as 1.
+ * \return 0 or < 0 on error.
+****************************************************************************/
+extern int microamp_dataready_handler_ex(microamp_state_t* microamp_state,int nhandle,void(*fn)(void*),void* arg,size_t rx_watermark);
+
 /** *************************************************************************   
  * \brief Add a dataempty event callback
  * \param callback A function pointer.
@@ -259,6 +742,17 @@ extern int microamp_dataready_handler(microamp_state_t* microamp_state,int nhand
 ****************************************************************************/
 extern int microamp_dataempty_handler(microamp_state_t* microamp_state,int nhandle,void(*fn)(void*),void* arg);
 
+/** *************************************************************************   
+ * \brief Add a dataempty event callback, edge triggered when the bytes 
+ *        available fall to \ref tx_low_watermark. The watermark applies 
+ *        to this C registration only.
+ * \param callback A function pointer.
+ * \param arg The arg to pass to the callback.
+ * \param tx_low_watermark The threshold in bytes, 0 is empty.
+ * \return 0 or < 0 on error.
+****************************************************************************/
+extern int microamp_dataempty_handler_ex(microamp_state_t* microamp_state,int nhandle,void(*fn)(void*),void* arg,size_t tx_low_watermark);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,112 @@
+/** *************************************************************************   
+ _____ _             _____ _____ _____ 
+|     |_|___ ___ ___|  _  |     |  _  |
+| | | | |  _|  _| . |     | | | |   __|
+|_|_|_|_|___|_| |___|__|__|_|_|_|__|                       
+
+MIT License
+
+Copyright (c) 2021 Mike Sharkey
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+****************************************************************************/
+#if defined(__linux__)
+
+#include "microamp_doorbell_eventfd.h"
+#include <stdint.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+static void microamp_doorbell_eventfd_ring(void* arg,int nendpoint);
+static int microamp_doorbell_eventfd_wait(void* arg,uint32_t timeout);
+
+
+/** *************************************************************************  
+*************************** 'C' Public Interface ****************************
+****************************************************************************/
+
+int microamp_doorbell_eventfd_create(void)
+{
+    return eventfd(0,EFD_NONBLOCK);
+}
+
+const microamp_doorbell_t* microamp_doorbell_eventfd_init(microamp_doorbell_eventfd_t* doorbell,int rx_fd,int tx_fd)
+{
+    if ( rx_fd < 0 || tx_fd < 0 )
+        return NULL;
+    doorbell->rx_fd = rx_fd;
+    doorbell->tx_fd = tx_fd;
+    doorbell->doorbell.ring = microamp_doorbell_eventfd_ring;
+    doorbell->doorbell.wait = microamp_doorbell_eventfd_wait;
+    doorbell->doorbell.arg = doorbell;
+    return &doorbell->doorbell;
+}
+
+void microamp_doorbell_eventfd_deinit(microamp_doorbell_eventfd_t* doorbell)
+{
+    if ( doorbell->rx_fd >= 0 )
+        close(doorbell->rx_fd);
+    if ( doorbell->tx_fd >= 0 && doorbell->tx_fd != doorbell->rx_fd )
+        close(doorbell->tx_fd);
+    doorbell->rx_fd = doorbell->tx_fd = -1;
+}
+
+
+/** *************************************************************************  
+*************************** 'C' Static Interface ****************************
+****************************************************************************/
+
+/** *************************************************************************  
+ * \brief Ring the other side by adding to its eventfd counter, which 
+ *        wakes its poll().
+****************************************************************************/
+static void microamp_doorbell_eventfd_ring(void* arg,int nendpoint)
+{
+    microamp_doorbell_eventfd_t* doorbell = (microamp_doorbell_eventfd_t*)arg;
+    uint64_t one = 1;
+    (void)nendpoint;
+    if ( write(doorbell->tx_fd,&one,sizeof(one)) < 0 )
+    {
+        /* EAGAIN, the counter is saturated and the doorbell already rung */
+    }
+}
+
+/** *************************************************************************  
+ * \brief Sleep in poll() for up to @ref timeout milliseconds, then drain 
+ *        the counter.
+ * \return 0 when rung, or MICROAMP_ERR_BLOCK on timeout.
+****************************************************************************/
+static int microamp_doorbell_eventfd_wait(void* arg,uint32_t timeout)
+{
+    microamp_doorbell_eventfd_t* doorbell = (microamp_doorbell_eventfd_t*)arg;
+    struct pollfd pfd = { doorbell->rx_fd, POLLIN, 0 };
+    uint64_t count;
+    int ms = timeout == MICROAMP_WAIT_FOREVER || timeout > INT32_MAX ? -1 : (int)timeout;
+    if ( poll(&pfd,1,ms) <= 0 )
+        return MICROAMP_ERR_BLOCK;
+    if ( read(doorbell->rx_fd,&count,sizeof(count)) < 0 )
+    {
+        /* EAGAIN, another waiter drained it first */
+    }
+    return 0;
+}
+
+#endif
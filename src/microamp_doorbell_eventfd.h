@@ -0,0 +1,79 @@
+/** *************************************************************************   
+ _____ _             _____ _____ _____ 
+|     |_|___ ___ ___|  _  |     |  _  |
+| | | | |  _|  _| . |     | | | |   __|
+|_|_|_|_|___|_| |___|__|__|_|_|_|__|                   
+
+MIT License
+
+Copyright (c) 2021 Mike Sharkey
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+****************************************************************************/
+#ifndef __MICROAMP_DOORBELL_EVENTFD_H__
+#define __MICROAMP_DOORBELL_EVENTFD_H__
+
+#include <microamp_c.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** *************************************************************************  
+ * \brief A pair of Linux eventfds standing in for the cross-core doorbell, 
+ *        so the notification path can be exercised on a host. Like a 
+ *        mailbox, each side sleeps on its own rx eventfd and rings the 
+ *        rx eventfd of the other side.
+****************************************************************************/
+typedef struct _microamp_doorbell_eventfd_
+{
+    microamp_doorbell_t     doorbell;
+    int                     rx_fd;
+    int                     tx_fd;
+} microamp_doorbell_eventfd_t;
+
+/** *************************************************************************  
+ * \brief Create an eventfd for use as one side's rx doorbell.
+ * \return The eventfd, or < 0 on error.
+****************************************************************************/
+extern int microamp_doorbell_eventfd_create(void);
+
+/** *************************************************************************  
+ * \brief Initialize an eventfd doorbell from eventfds inherited across 
+ *        fork() or passed over a unix socket.
+ * \param doorbell Pointer to storage for the doorbell.
+ * \param rx_fd The eventfd this side waits on.
+ * \param tx_fd The eventfd the other side waits on.
+ * \return The doorbell to pass to microamp_set_doorbell(), or NULL on error.
+****************************************************************************/
+extern const microamp_doorbell_t* microamp_doorbell_eventfd_init(microamp_doorbell_eventfd_t* doorbell,int rx_fd,int tx_fd);
+
+/** *************************************************************************  
+ * \brief Close the eventfds of a doorbell.
+ * \param doorbell Pointer to the doorbell.
+****************************************************************************/
+extern void microamp_doorbell_eventfd_deinit(microamp_doorbell_eventfd_t* doorbell);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,219 @@
+/** *************************************************************************   
+ _____ _             _____ _____ _____ 
+|     |_|___ ___ ___|  _  |     |  _  |
+| | | | |  _|  _| . |     | | | |   __|
+|_|_|_|_|___|_| |___|__|__|_|_|_|__|                       
+
+MIT License
+
+Copyright (c) 2021 Mike Sharkey
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+****************************************************************************/
+#if defined(__linux__)
+
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#include "microamp_host.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define MICROAMP_HOST_MAGIC     0x504D4121  /**< "!AMP" */
+#define MICROAMP_HOST_PAGE      4096
+
+/** *************************************************************************  
+ * \brief The head of the mapped region, the shared RAM follows at the next 
+ *        page boundary.
+****************************************************************************/
+typedef struct _microamp_host_region_
+{
+    uint32_t                magic;
+    uint32_t                ready;
+    size_t                  shared_off;
+    size_t                  shared_size;
+    microamp_state_t        state;
+} microamp_host_region_t;
+
+static microamp_host_region_t* microamp_host_map(microamp_host_t* host,int fd,size_t mapsz);
+
+/** *************************************************************************  
+ * \note One region per process, as it is mapped at a fixed address.
+****************************************************************************/
+static microamp_host_region_t* microamp_host_region=NULL;
+
+
+/** *************************************************************************  
+*************************** 'C' Public Interface ****************************
+****************************************************************************/
+
+microamp_state_t* microamp_host_create(microamp_host_t* host,const char* name,size_t shared_size)
+{
+    microamp_host_region_t* region;
+    size_t shared_off = (sizeof(microamp_host_region_t)+MICROAMP_HOST_PAGE-1) & ~(size_t)(MICROAMP_HOST_PAGE-1);
+    int fd;
+
+    memset(host,0,sizeof(microamp_host_t));
+    host->fd = -1;
+    if ( name != NULL && strlen(name) > MICROAMP_HOST_MAX_NAME )
+        return NULL;
+    if ( name != NULL )
+        fd = shm_open(name,O_RDWR|O_CREAT|O_EXCL,0600);
+    else
+        fd = memfd_create("microamp",0);
+    if ( fd < 0 )
+        return NULL;
+    if ( name != NULL )
+    {
+        strcpy(host->name,name);
+        host->owner = true;
+    }
+    if ( ftruncate(fd,shared_off+shared_size) < 0 || (region=microamp_host_map(host,fd,shared_off+shared_size)) == NULL )
+    {
+        if ( host->fd < 0 )
+            close(fd);
+        microamp_host_detach(host);
+        return NULL;
+    }
+
+    region->magic = MICROAMP_HOST_MAGIC;
+    region->shared_off = shared_off;
+    region->shared_size = shared_size;
+    microamp_init(&region->state);
+    __atomic_store_n(&region->ready,1,__ATOMIC_RELEASE);
+    return &region->state;
+}
+
+microamp_state_t* microamp_host_attach(microamp_host_t* host,const char* name)
+{
+    int fd = shm_open(name,O_RDWR,0);
+    if ( fd < 0 )
+        return NULL;
+    return microamp_host_attach_fd(host,fd);
+}
+
+microamp_state_t* microamp_host_attach_fd(microamp_host_t* host,int fd)
+{
+    microamp_host_region_t* region;
+    microamp_host_region_t header;
+    size_t hdrsz = offsetof(microamp_host_region_t,state);
+    struct stat st;
+
+    memset(host,0,sizeof(microamp_host_t));
+    host->fd = -1;
+    /** Check the shared RAM the creator advertises lies within the file, 
+     *  before mapping it and handing it to the ring code. */
+    if ( fstat(fd,&st) < 0 || (size_t)st.st_size < sizeof(microamp_host_region_t) ||
+         pread(fd,&header,hdrsz,0) != (ssize_t)hdrsz ||
+         header.shared_off < sizeof(microamp_host_region_t) ||
+         header.shared_off > (size_t)st.st_size ||
+         header.shared_size > (size_t)st.st_size - header.shared_off ||
+         (region=microamp_host_map(host,fd,st.st_size)) == NULL )
+    {
+        close(fd);
+        return NULL;
+    }
+    if ( region->magic != MICROAMP_HOST_MAGIC || !__atomic_load_n(&region->ready,__ATOMIC_ACQUIRE) )
+    {
+        microamp_host_detach(host);
+        return NULL;
+    }
+    microamp_attach(&region->state);
+    return &region->state;
+}
+
+void microamp_host_detach(microamp_host_t* host)
+{
+    if ( host->addr != NULL )
+    {
+        if ( (void*)microamp_host_region == host->addr )
+            microamp_host_region = NULL;
+        munmap(host->addr,host->mapsz);
+    }
+    if ( host->fd >= 0 )
+        close(host->fd);
+    if ( host->owner )
+        shm_unlink(host->name);
+    memset(host,0,sizeof(microamp_host_t));
+    host->fd = -1;
+}
+
+void* microamp_host_shmem_base(void)
+{
+    if ( microamp_host_region == NULL )
+        return NULL;
+    return (uint8_t*)microamp_host_region + microamp_host_region->shared_off;
+}
+
+size_t microamp_host_shmem_size(void)
+{
+    if ( microamp_host_region == NULL )
+        return 0;
+    return microamp_host_region->shared_size;
+}
+
+uint32_t microamp_host_cycles(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return (uint32_t)((now.tv_sec*1000000000ull) + now.tv_nsec);
+}
+
+
+/** *************************************************************************  
+*************************** 'C' Static Interface ****************************
+****************************************************************************/
+
+/** *************************************************************************  
+ * \brief Map @ref fd at MICROAMP_HOST_ADDR, failing rather than moving it 
+ *        when something else already occupies that range.
+ * \return The region, or NULL on error.
+****************************************************************************/
+static microamp_host_region_t* microamp_host_map(microamp_host_t* host,int fd,size_t mapsz)
+{
+    void* addr;
+    int flags = MAP_SHARED;
+    if ( microamp_host_region != NULL )
+        return NULL;
+#if defined(MAP_FIXED_NOREPLACE)
+    flags |= MAP_FIXED_NOREPLACE;
+#endif
+    addr = mmap((void*)MICROAMP_HOST_ADDR,mapsz,PROT_READ|PROT_WRITE,flags,fd,0);
+    if ( addr == MAP_FAILED )
+        return NULL;
+    if ( addr != (void*)MICROAMP_HOST_ADDR )
+    {
+        munmap(addr,mapsz);
+        return NULL;
+    }
+    host->fd = fd;
+    host->addr = addr;
+    host->mapsz = mapsz;
+    microamp_host_region = (microamp_host_region_t*)addr;
+    return microamp_host_region;
+}
+
+#endif
@@ -0,0 +1,123 @@
+/** *************************************************************************   
+ _____ _             _____ _____ _____ 
+|     |_|___ ___ ___|  _  |     |  _  |
+| | | | |  _|  _| . |     | | | |   __|
+|_|_|_|_|___|_| |___|__|__|_|_|_|__|                       
+
+MIT License
+
+Copyright (c) 2021 Mike Sharkey
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+****************************************************************************/
+#ifndef __MICROAMP_HOST_H__
+#define __MICROAMP_HOST_H__
+
+#include <microamp_c.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if !defined(MICROAMP_HOST_ADDR)
+#if UINTPTR_MAX > 0xFFFFFFFF
+#define MICROAMP_HOST_ADDR  0x3E0000000000  /**< where every process maps the region */
+#else
+#define MICROAMP_HOST_ADDR  0x60000000
+#endif
+#endif
+
+#define MICROAMP_HOST_MAX_NAME  31  /**< Maximum shm_open() name length */
+
+/** *************************************************************************  
+ * \brief A Linux host mapping standing in for the shared RAM of the target. 
+ *        The region holds the microamp_state_t followed by the shared RAM
+ *        the endpoint rings are allocated from. Endpoints record absolute
+ *        ring addresses, so every process maps it at MICROAMP_HOST_ADDR.
+ * \note The mutexes are process-shared futexes, so read/write/open/close
+ *       work from any process. Event handlers hold function pointers of 
+ *       the process which installed them, install handlers and run 
+ *       microamp_poll_hook() in that process only.
+****************************************************************************/
+typedef struct _microamp_host_
+{
+    int                     fd;
+    void*                   addr;
+    size_t                  mapsz;
+    bool                    owner;
+    char                    name[MICROAMP_HOST_MAX_NAME+1];
+} microamp_host_t;
+
+/** *************************************************************************  
+ * \brief Create and map a region with @ref shared_size bytes of shared RAM,
+ *        and initialize the MicroAMP state in it.
+ * \param host Pointer to storage for the mapping.
+ * \param name The shm_open() name, such as "/microamp", or NULL for an 
+ *        anonymous memfd which is inherited across fork() or passed as 
+ *        host->fd over a unix socket.
+ * \param shared_size The number of bytes of shared RAM.
+ * \return The MicroAMP state, or NULL on error.
+****************************************************************************/
+extern microamp_state_t* microamp_host_create(microamp_host_t* host,const char* name,size_t shared_size);
+
+/** *************************************************************************  
+ * \brief Map a region created by another process with microamp_host_create().
+ * \param host Pointer to storage for the mapping.
+ * \param name The shm_open() name.
+ * \return The MicroAMP state, or NULL on error.
+****************************************************************************/
+extern microamp_state_t* microamp_host_attach(microamp_host_t* host,const char* name);
+
+/** *************************************************************************  
+ * \brief Map a region from a file descriptor, such as a memfd.
+ * \param host Pointer to storage for the mapping.
+ * \param fd The file descriptor, owned by \ref host from here on.
+ * \return The MicroAMP state, or NULL on error.
+****************************************************************************/
+extern microamp_state_t* microamp_host_attach_fd(microamp_host_t* host,int fd);
+
+/** *************************************************************************  
+ * \brief Unmap the region, the creator also unlinks its name.
+ * \param host Pointer to the mapping.
+****************************************************************************/
+extern void microamp_host_detach(microamp_host_t* host);
+
+/** *************************************************************************  
+ * \return The base of the shared RAM in the mapped region, or NULL.
+****************************************************************************/
+extern void* microamp_host_shmem_base(void);
+
+/** *************************************************************************  
+ * \return The size of the shared RAM in the mapped region, or 0.
+****************************************************************************/
+extern size_t microamp_host_shmem_size(void);
+
+/** *************************************************************************  
+ * \return CLOCK_MONOTONIC in nanoseconds, truncated, the host stand-in for 
+ *         a cycle counter.
+****************************************************************************/
+extern uint32_t microamp_host_cycles(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif